@@ -0,0 +1,482 @@
+// kit microbenchmarks, build and run with `make bench`
+// usage: kit_bench [kit_binary] [commit]
+// every case reports throughput, latency percentiles and heap allocations per call, the json
+// result goes to stdout and a human readable line per case goes to stderr. built with
+// KIT_ALLOC_STATS, a case over its allocation budget makes kit_bench exit non zero
+#define KIT_LIB
+#include "../main.c"
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+
+#define BENCH_MAX_RESULTS     64
+#define BENCH_MAX_SAMPLES     1000
+#define BENCH_MIN_SAMPLES     5
+#define BENCH_MIN_SAMPLE_NS   10000ull     // batch calls until one sample takes at least 10us
+#define BENCH_CASE_BUDGET_NS  200000000ull // 200ms per case
+
+extern char **environ;
+
+typedef void (*BenchFn)(void *ctx);
+
+struct BenchResult {
+        char name[64];
+        long samples;
+        long batch;
+        double ops_per_sec;
+        double mean_ns;
+        double p50_ns;
+        double p95_ns;
+        double p99_ns;
+        double max_ns;
+        long allocs;  // heap allocations of one call
+        long budget;  // most allocations allowed per call, -1 for no budget
+};
+
+// allocations one call of a case may make, the first entry whose name is a prefix of the case applies.
+// config keeps three(config, items, strings), everything else runs on stack buffers and the arena
+static const struct {
+        const char *name;
+        long allocs;
+} bench_budgets[] = {
+        { "config_init/",       3 },
+        { "config_find/",       0 },
+        { "config_print/",      3 }, // rows, widths, output buffer
+        { "complete/",          0 },
+        { "fuzzy/",             0 },
+        { "decimal_to_binary/", 0 },
+        { "decimal_to_hex",     0 },
+        { "hex_to_binary",      0 },
+        { "timestamp_convert/", 0 },
+        { "db_alarm_query",     0 },
+        { "command/-cv",        3 }, // parses the config
+        { "command/",           0 },
+};
+
+struct Bench {
+        int len;
+        struct BenchResult results[BENCH_MAX_RESULTS];
+};
+
+static struct Bench bench;
+
+long bench_budget(const char *name)
+{
+        for (size_t i = 0; i < sizeof(bench_budgets) / sizeof(*bench_budgets); ++i) {
+                if (strncmp(name, bench_budgets[i].name, strlen(bench_budgets[i].name)) == 0)
+                        return bench_budgets[i].allocs;
+        }
+        return -1;
+}
+
+// allocations of one more call, after the timed ones so one time setup(stdio buffers, tz data) is not in it
+long bench_allocs(BenchFn fn, void *ctx)
+{
+#ifdef KIT_ALLOC_STATS
+        long count = alloc_stats.count;
+        fn(ctx);
+        return alloc_stats.count - count;
+#else
+        (void)fn;
+        (void)ctx;
+        return -1;
+#endif
+}
+
+uint64_t bench_now_ns()
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t bench_time_batch(BenchFn fn, void *ctx, long batch)
+{
+        uint64_t start = bench_now_ns();
+        for (long i = 0; i < batch; ++i)
+                fn(ctx);
+        return bench_now_ns() - start;
+}
+
+int bench_cmp_double(const void *a, const void *b)
+{
+        double x = *(const double *)a;
+        double y = *(const double *)b;
+        return (x > y) - (x < y);
+}
+
+double bench_percentile(double *sorted, long len, double p)
+{
+        long i = (long)(p * (len - 1) + 0.5);
+        return sorted[i];
+}
+
+void bench_run(const char *name, BenchFn fn, void *ctx)
+{
+        if (bench.len == BENCH_MAX_RESULTS)
+                fatal("ERROR: bench_run too many benchmarks, max is %d", BENCH_MAX_RESULTS);
+        // calibrate, also serves as warmup
+        long batch = 1;
+        uint64_t sample_ns;
+        while ((sample_ns = bench_time_batch(fn, ctx, batch)) < BENCH_MIN_SAMPLE_NS)
+                batch *= 2;
+        long samples = (long)(BENCH_CASE_BUDGET_NS / (sample_ns + 1));
+        samples = MAX(BENCH_MIN_SAMPLES, MIN(BENCH_MAX_SAMPLES, samples));
+        double per_op[BENCH_MAX_SAMPLES];
+        double total = 0;
+        for (long i = 0; i < samples; ++i) {
+                per_op[i] = (double)bench_time_batch(fn, ctx, batch) / batch;
+                total += per_op[i];
+        }
+        qsort(per_op, samples, sizeof(*per_op), bench_cmp_double);
+        struct BenchResult *r = &bench.results[bench.len++];
+        snprintf(r->name, sizeof(r->name), "%s", name);
+        r->samples = samples;
+        r->batch = batch;
+        r->mean_ns = total / samples;
+        r->ops_per_sec = 1e9 / r->mean_ns;
+        r->p50_ns = bench_percentile(per_op, samples, 0.50);
+        r->p95_ns = bench_percentile(per_op, samples, 0.95);
+        r->p99_ns = bench_percentile(per_op, samples, 0.99);
+        r->max_ns = per_op[samples - 1];
+        r->allocs = bench_allocs(fn, ctx);
+        r->budget = bench_budget(name);
+        fprintf(stderr, "%-32s %14.1f ops/s  p50 %12.1fns  p95 %12.1fns  p99 %12.1fns  allocs %ld\n",
+                r->name, r->ops_per_sec, r->p50_ns, r->p95_ns, r->p99_ns, r->allocs);
+}
+
+void bench_print_json(const char *commit)
+{
+        printf("{\n  \"commit\": \"%s\",\n  \"benchmarks\": [", commit);
+        for (int i = 0; i < bench.len; ++i) {
+                struct BenchResult *r = &bench.results[i];
+                printf("%s\n    {\"name\": \"%s\", \"samples\": %ld, \"batch\": %ld, \"ops_per_sec\": %.1f, "
+                       "\"mean_ns\": %.1f, \"p50_ns\": %.1f, \"p95_ns\": %.1f, \"p99_ns\": %.1f, \"max_ns\": %.1f, "
+                       "\"allocs\": %ld, \"alloc_budget\": %ld}",
+                       i == 0 ? "" : ",", r->name, r->samples, r->batch, r->ops_per_sec,
+                       r->mean_ns, r->p50_ns, r->p95_ns, r->p99_ns, r->max_ns, r->allocs, r->budget);
+        }
+        printf("\n  ]\n}\n");
+}
+
+// number of cases over their allocation budget, each one is reported on stderr
+int bench_check_budgets()
+{
+        int over = 0;
+        for (int i = 0; i < bench.len; ++i) {
+                struct BenchResult *r = &bench.results[i];
+                if (r->budget >= 0 && r->allocs > r->budget) {
+                        fprintf(stderr, "FAIL: %s makes %ld allocations per call, budget is %ld\n", r->name, r->allocs, r->budget);
+                        over++;
+                }
+        }
+        return over;
+}
+
+// generate a config.txt like buffer with n ssh entries
+unsigned char *bench_config_txt(int n, unsigned int *txt_len)
+{
+        size_t cap = (size_t)n * 96 + 64;
+        char *txt = malloc(cap);
+        if (txt == NULL)
+                fatal("ERROR: bench_config_txt txt malloc fail");
+        size_t len = snprintf(txt, cap, "# generated by kit_bench\n");
+        for (int i = 0; i < n; ++i)
+                len += snprintf(txt + len, cap - len, "[server %d] [ssh user%d@10.%d.%d.%d -p %d] [password%d]\n",
+                                i, i, (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff, 2000 + i % 1000, i);
+        *txt_len = (unsigned int)len;
+        return (unsigned char *)txt;
+}
+
+struct ConfigCtx {
+        unsigned char *txt;
+        unsigned int txt_len;
+        struct Config *config;
+        char **names;
+        int next;
+};
+
+void bench_config_init(void *ctx)
+{
+        struct ConfigCtx *c = ctx;
+        config_destroy(config_init_from(c->txt, c->txt_len));
+}
+
+void bench_config_find(void *ctx)
+{
+        struct ConfigCtx *c = ctx;
+        // stride through names so lookups hit all over the table
+        c->next = (c->next + 7919) % c->config->len;
+        if (config_find(c->config, c->names[c->next]) != c->next)
+                fatal("ERROR: bench_config_find lookup mismatch");
+}
+
+void bench_config_print(void *ctx)
+{
+        struct ConfigCtx *c = ctx;
+        config_print(c->config, NULL);
+}
+
+void bench_decimal_to_binary(void *ctx)
+{
+        char binary[NUMBER_STR_SIZE];
+        decimal_to_binary(ctx, binary, sizeof(binary));
+}
+
+void bench_decimal_to_hex(void *ctx)
+{
+        char hex[NUMBER_STR_SIZE];
+        decimal_to_hex(ctx, hex, sizeof(hex));
+}
+
+void bench_hex_to_binary(void *ctx)
+{
+        char binary[NUMBER_STR_SIZE];
+        hex_to_binary(ctx, binary, sizeof(binary));
+}
+
+// one whole kit command in process: parse, run every action, tear down. the clipboard is
+// collected but not written, so xclip is not part of it
+void bench_command(void *ctx)
+{
+        char **argv = ctx;
+        int argc = 0;
+        while (argv[argc] != NULL)
+                argc++;
+        struct App app;
+        app_init(&app, argc, argv);
+        for (int i = 0; i < app.actions_len; ++i)
+                app.actions[i].flag->run(&app, &app.actions[i]);
+        app_destroy(&app);
+}
+
+void bench_timestamp_convert(void *ctx)
+{
+        char out[64];
+        timestamp_convert(ctx, out, sizeof(out));
+}
+
+void bench_db_alarm_query(void *ctx)
+{
+        char query[256];
+        db_alarm_query(query, sizeof(query), "wash", true, "3", ctx);
+}
+
+struct StartupCtx {
+        char **argv;
+        posix_spawn_file_actions_t actions;
+};
+
+void bench_startup(void *ctx)
+{
+        struct StartupCtx *s = ctx;
+        pid_t pid;
+        int rc = posix_spawn(&pid, s->argv[0], &s->actions, NULL, s->argv, environ);
+        if (rc != 0)
+                fatal("ERROR: bench_startup posix_spawn %s fail: %s", s->argv[0], strerror(rc));
+        int status;
+        if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                fatal("ERROR: bench_startup %s did not exit cleanly", s->argv[0]);
+}
+
+void bench_config_by_name(void *ctx)
+{
+        struct Config *config = ctx;
+        free(config->by_name);
+        config->by_name = NULL;
+        config_by_name(config);
+}
+
+void bench_config_fuzzy_index(void *ctx)
+{
+        struct Config *config = ctx;
+        fuzzy_index_destroy(config->fuzzy);
+        config->fuzzy = NULL;
+        config_fuzzy_index(config);
+}
+
+struct FuzzyCtx {
+        struct Config *config;
+        const char *query;
+};
+
+void bench_fuzzy_search(void *ctx)
+{
+        struct FuzzyCtx *f = ctx;
+        struct FuzzyMatch matches[FUZZY_SUGGESTIONS];
+        fuzzy_search(f->config, f->query, true, matches, FUZZY_SUGGESTIONS);
+}
+
+struct CompleteCtx {
+        struct App app;
+        struct Action action;
+};
+
+void bench_complete(void *ctx)
+{
+        struct CompleteCtx *c = ctx;
+        run_complete(&c->app, &c->action);
+}
+
+// one round trip to kit --serve without the exec of a client process
+void bench_server_request(void *ctx)
+{
+        char **argv = ctx;
+        int argc = 0;
+        while (argv[argc] != NULL)
+                argc++;
+        int exit_code;
+        if (!client_forward(argc, argv, &exit_code) || exit_code != 0)
+                fatal("ERROR: bench_server_request forward fail");
+}
+
+// run fn with stdout pointed at /dev/null, so terminal speed is not part of the measurement
+void bench_run_silent(const char *name, BenchFn fn, void *ctx)
+{
+        fflush(stdout);
+        int saved = dup(STDOUT_FILENO);
+        int devnull = open("/dev/null", O_WRONLY);
+        if (saved == -1 || devnull == -1)
+                fatal("ERROR: bench_run_silent redirect stdout fail: %s", strerror(errno));
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+        bench_run(name, fn, ctx);
+        fflush(stdout);
+        dup2(saved, STDOUT_FILENO);
+        close(saved);
+}
+
+// every spelling in flags[] is also a case in flag_lookup, a flag added to one but not the other
+// (or with a typo in either) would otherwise only show up as "unknown flag" at run time
+void bench_check_flags()
+{
+        for (int i = 0; i < FLAG_COUNT; ++i) {
+                if (flags[i].short_name && flag_lookup(flags[i].short_name) != &flags[i])
+                        fatal("ERROR: flag_lookup(\"%s\") does not find flags[%d]", flags[i].short_name, i);
+                if (flag_lookup(flags[i].long_name) != &flags[i])
+                        fatal("ERROR: flag_lookup(\"%s\") does not find flags[%d]", flags[i].long_name, i);
+        }
+}
+
+int main(int argc, char **argv)
+{
+        bench_check_flags();
+        timezone_init();
+        char name[64];
+        int sizes[] = { 10, 100, 1000, 10000, 100000 };
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i) {
+                struct ConfigCtx c = {0};
+                c.txt = bench_config_txt(sizes[i], &c.txt_len);
+                c.config = config_init_from(c.txt, c.txt_len);
+                c.names = malloc(sizeof(*c.names) * c.config->len);
+                if (c.names == NULL)
+                        fatal("ERROR: bench main names malloc fail");
+                for (int j = 0; j < c.config->len; ++j)
+                        c.names[j] = strdup(c.config->items[j].name);
+                snprintf(name, sizeof(name), "config_init/%d", sizes[i]);
+                bench_run(name, bench_config_init, &c);
+                snprintf(name, sizeof(name), "config_find/%d", sizes[i]);
+                bench_run(name, bench_config_find, &c);
+                if (sizes[i] <= 10000) {
+                        snprintf(name, sizeof(name), "config_print/%d", sizes[i]);
+                        bench_run_silent(name, bench_config_print, &c);
+                }
+                for (int j = 0; j < c.config->len; ++j)
+                        free(c.names[j]);
+                free(c.names);
+                config_destroy(c.config);
+                free(c.txt);
+        }
+        // completion answers from the sorted name index, building it is a one time cost per process(or per server)
+        {
+                unsigned int txt_len;
+                unsigned char *txt = bench_config_txt(50000, &txt_len);
+                struct CompleteCtx c = {0};
+                c.app.config = config_init_from(txt, txt_len);
+                bench_run("complete_index/50000", bench_config_by_name, c.app.config);
+                char *words[] = { "-ssh", "server 123" };
+                c.action = (struct Action){ .flag = &flags[FLAG_COMPLETE], .args = words, .args_len = 2 };
+                bench_run_silent("complete/50000 -ssh prefix", bench_complete, &c);
+                words[1] = "server 4999";
+                bench_run_silent("complete/50000 -ssh unique", bench_complete, &c);
+                // suggestions on a miss
+                config_fuzzy_index(c.app.config);
+                bench_run("fuzzy_index/50000", bench_config_fuzzy_index, c.app.config);
+                struct FuzzyCtx f = { .config = c.app.config, .query = "srever 4999" };
+                bench_run("fuzzy/50000 typo", bench_fuzzy_search, &f);
+                f.query = "zzzz";
+                bench_run("fuzzy/50000 no match", bench_fuzzy_search, &f);
+                config_destroy(c.app.config);
+                free(txt);
+        }
+        bench_run("decimal_to_binary/positive", bench_decimal_to_binary, "123456789");
+        bench_run("decimal_to_binary/negative", bench_decimal_to_binary, "-123456789");
+        bench_run("decimal_to_hex", bench_decimal_to_hex, "123456789");
+        bench_run("hex_to_binary", bench_hex_to_binary, "0x75bcd15");
+        bench_run("timestamp_convert/epoch", bench_timestamp_convert, "1757651421");
+        bench_run("timestamp_convert/formattime", bench_timestamp_convert, "2025-09-12 12:30:21");
+        bench_run("db_alarm_query", bench_db_alarm_query, "2025-09-12 12:30:21");
+        char *number_argv[] = { "kit", "-n", "-123456789", NULL };
+        bench_run_silent("command/-n", bench_command, number_argv);
+        char *timestamp_argv[] = { "kit", "-t", "1757651421", NULL };
+        bench_run_silent("command/-t", bench_command, timestamp_argv);
+        char *query_argv[] = { "kit", "-qb", "-ql", "-qw", "-qln", "2", NULL };
+        bench_run_silent("command/-qb -ql -qw", bench_command, query_argv);
+        // first name of the built in config.txt, whatever it is
+        struct Config *builtin = config_init();
+        if (builtin->len > 0) {
+                char *config_value_argv[] = { "kit", "-cv", builtin->items[0].name, NULL };
+                bench_run_silent("command/-cv", bench_command, config_value_argv);
+        }
+        config_destroy(builtin);
+        if (argc > 1) {
+                // -n touches neither config nor clipboard, so it is pure process startup + one conversion
+                char *startup_argv[] = { argv[1], "-n", "42", NULL };
+                struct StartupCtx s = { .argv = startup_argv };
+                posix_spawn_file_actions_init(&s.actions);
+                posix_spawn_file_actions_addopen(&s.actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+                setenv("KIT_NO_SERVER", "1", 1);
+                bench_run("startup/kit -n", bench_startup, &s);
+                // -c is what the server is for, it reads the config
+                char *config_argv[] = { argv[1], "-c", NULL };
+                struct StartupCtx c = { .argv = config_argv };
+                posix_spawn_file_actions_init(&c.actions);
+                posix_spawn_file_actions_addopen(&c.actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+                bench_run("startup/kit -c", bench_startup, &c);
+                unsetenv("KIT_NO_SERVER");
+                // same call with a private kit --serve up, only forwarded for a config.txt of SERVER_MIN_CONFIG or more
+                char socket_path[64];
+                snprintf(socket_path, sizeof(socket_path), "/tmp/kit-bench-%d.sock", (int)getpid());
+                setenv("KIT_SOCKET", socket_path, 1);
+                char *serve_argv[] = { argv[1], "--serve", NULL };
+                posix_spawn_file_actions_t serve_actions;
+                posix_spawn_file_actions_init(&serve_actions);
+                posix_spawn_file_actions_addopen(&serve_actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+                pid_t server;
+                if (posix_spawn(&server, argv[1], &serve_actions, NULL, serve_argv, environ) != 0)
+                        fatal("ERROR: bench main spawn kit --serve fail");
+                struct sockaddr_un addr;
+                server_address(&addr);
+                bool ready = false;
+                for (int i = 0; i < 500 && !ready; ++i) {
+                        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+                        ready = connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+                        close(fd);
+                        if (!ready)
+                                usleep(1000);
+                }
+                if (ready) {
+                        bench_run("startup/kit -c (server)", bench_startup, &c);
+                        bench_run_silent("server/request -c", bench_server_request, config_argv);
+                } else
+                        fprintf(stderr, "kit --serve did not come up, skip startup/kit -c (server)\n");
+                kill(server, SIGTERM);
+                waitpid(server, NULL, 0);
+                unlink(socket_path);
+                posix_spawn_file_actions_destroy(&serve_actions);
+                posix_spawn_file_actions_destroy(&s.actions);
+                posix_spawn_file_actions_destroy(&c.actions);
+        }
+        bench_print_json(argc > 2 ? argv[2] : "unknown");
+        return bench_check_budgets() == 0 ? 0 : 1;
+}
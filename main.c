@@ -1,6 +1,7 @@
 #define _GNU_SOURCE   // getline
 #define _XOPEN_SOURCE // strptime
 #include <stdbool.h>
+#include <stddef.h>   // offsetof
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,11 +12,24 @@
 #include <sys/wait.h>
 #include <sys/time.h> // gettimeofday
 #include <errno.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <ftw.h>      // nftw
+#include <limits.h>   // PATH_MAX
+#include <netdb.h>    // getaddrinfo
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/ioctl.h> // TIOCGWINSZ
+#include <signal.h>
 
 #define ANSI_COLOR_YELLOW     "\x1b[33m"
 #define ANSI_COLOR_RESET      "\x1b[0m"
 #define EPOCH_SECCOND_LEN     10
 #define EPOCH_MILLISECOND_LEN 13
+#define NUMBER_STR_SIZE       128 // 64 bits in groups of 8 plus "(length: 64)"
 
 extern unsigned char config_txt[];
 extern unsigned int  config_txt_len;
@@ -30,6 +44,271 @@ void fatal(char *format, ...)
         exit(EXIT_FAILURE);
 }
 
+// build with `make trace` (-DKIT_TRACING) and run with KIT_TRACE=<file> to get
+// chrome trace-event json (chrome://tracing, ui.perfetto.dev) plus a summary on stderr,
+// without KIT_TRACING the macros compile to nothing
+#ifdef KIT_TRACING
+#define TRACE_MAX_SPANS 4096
+
+struct TraceSpan {
+        const char *name;
+        uint64_t start_ns;
+        uint64_t end_ns;
+};
+
+struct Trace {
+        bool enabled;
+        pid_t pid;
+        char *path;
+        int len;
+        struct TraceSpan spans[TRACE_MAX_SPANS];
+};
+
+static struct Trace trace;
+
+uint64_t trace_now_ns()
+{
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void trace_flush()
+{
+        // forked child exiting through fatal() should not clobber the parent's trace
+        if (!trace.enabled || getpid() != trace.pid)
+                return;
+        FILE *f = fopen(trace.path, "w");
+        if (f == NULL) {
+                fprintf(stderr, "ERROR: trace_flush fopen %s fail: %s\n", trace.path, strerror(errno));
+                return;
+        }
+        uint64_t origin = trace.len > 0 ? trace.spans[0].start_ns : 0;
+        fprintf(f, "{\"traceEvents\":[");
+        for (int i = 0; i < trace.len; ++i) {
+                struct TraceSpan *span = &trace.spans[i];
+                uint64_t end = span->end_ns ? span->end_ns : trace_now_ns(); // unfinished span, e.g. fatal() inside it
+                fprintf(f, "%s\n{\"name\":\"%s\",\"cat\":\"kit\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                        i == 0 ? "" : ",", span->name, (int)trace.pid, (int)trace.pid,
+                        (span->start_ns - origin) / 1000.0, (end - span->start_ns) / 1000.0);
+        }
+        fprintf(f, "\n],\"displayTimeUnit\":\"ns\"}\n");
+        fclose(f);
+        // terse summary, spans with the same name are aggregated in first seen order
+        fprintf(stderr, "trace: %d spans -> %s\n", trace.len, trace.path);
+        bool seen[TRACE_MAX_SPANS] = {false};
+        for (int i = 0; i < trace.len; ++i) {
+                if (seen[i])
+                        continue;
+                int count = 0;
+                uint64_t total = 0;
+                uint64_t max = 0;
+                for (int j = i; j < trace.len; ++j) {
+                        if (strcmp(trace.spans[i].name, trace.spans[j].name) != 0)
+                                continue;
+                        seen[j] = true;
+                        uint64_t end = trace.spans[j].end_ns ? trace.spans[j].end_ns : trace_now_ns();
+                        uint64_t dur = end - trace.spans[j].start_ns;
+                        count++;
+                        total += dur;
+                        max = MAX(max, dur);
+                }
+                fprintf(stderr, "trace: %-24s count %-5d total %12.3fus  max %12.3fus\n",
+                        trace.spans[i].name, count, total / 1000.0, max / 1000.0);
+        }
+}
+
+// called again by a server request with the caller's environment, starts over with its KIT_TRACE
+void trace_init()
+{
+        static bool registered = false;
+        char *path = getenv("KIT_TRACE");
+        trace.enabled = path != NULL && path[0] != '\0';
+        trace.len = 0;
+        if (!trace.enabled)
+                return;
+        trace.pid = getpid();
+        trace.path = path;
+        if (!registered)
+                atexit(trace_flush);
+        registered = true;
+}
+
+int trace_begin(const char *name)
+{
+        if (!trace.enabled || trace.len == TRACE_MAX_SPANS)
+                return -1;
+        trace.spans[trace.len].name = name;
+        trace.spans[trace.len].start_ns = trace_now_ns();
+        trace.spans[trace.len].end_ns = 0;
+        return trace.len++;
+}
+
+void trace_end(int span)
+{
+        if (span >= 0)
+                trace.spans[span].end_ns = trace_now_ns();
+}
+
+#define TRACE_INIT()            trace_init()
+#define TRACE_FLUSH()           trace_flush()
+#define TRACE_BEGIN(span, name) int span = trace_begin(name)
+#define TRACE_END(span)         trace_end(span)
+#else
+#define TRACE_INIT()            do {} while (0)
+#define TRACE_FLUSH()           do {} while (0)
+#define TRACE_BEGIN(span, name) do {} while (0)
+#define TRACE_END(span)         do {} while (0)
+#endif
+
+// build with `make alloc` (-DKIT_ALLOC_STATS) to count heap allocations: malloc/calloc/realloc/free
+// are interposed here, so allocations inside libc(popen, getaddrinfo, tzset) are counted too,
+// and every command reports its allocation count and peak heap bytes on stderr.
+// without KIT_ALLOC_STATS the macros compile to nothing
+#if defined(KIT_ALLOC_STATS) && !defined(__GLIBC__)
+// the interposer forwards to glibc's __libc_* entry points, other libcs(e.g. macOS) build without it
+// and bench reports allocs -1
+#undef KIT_ALLOC_STATS
+#endif
+#ifdef KIT_ALLOC_STATS
+#include <malloc.h> // malloc_usable_size
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+struct AllocStats {
+        long count;  // allocations so far
+        size_t live; // heap bytes in use
+        size_t peak; // most heap bytes in use since the last alloc_stats_begin
+};
+
+static struct AllocStats alloc_stats;
+
+void alloc_stats_add(void *ptr)
+{
+        if (ptr == NULL)
+                return;
+        alloc_stats.count++;
+        alloc_stats.live += malloc_usable_size(ptr);
+        alloc_stats.peak = MAX(alloc_stats.peak, alloc_stats.live);
+}
+
+void alloc_stats_sub(size_t size)
+{
+        // memory from memalign and friends is not counted in but freed here
+        alloc_stats.live = alloc_stats.live > size ? alloc_stats.live - size : 0;
+}
+
+void *malloc(size_t size)
+{
+        void *ptr = __libc_malloc(size);
+        alloc_stats_add(ptr);
+        return ptr;
+}
+
+void *calloc(size_t n, size_t size)
+{
+        void *ptr = __libc_calloc(n, size);
+        alloc_stats_add(ptr);
+        return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+        size_t old = ptr ? malloc_usable_size(ptr) : 0;
+        void *moved = __libc_realloc(ptr, size);
+        if (moved != NULL || size == 0)
+                alloc_stats_sub(old);
+        alloc_stats_add(moved);
+        return moved;
+}
+
+void free(void *ptr)
+{
+        if (ptr != NULL)
+                alloc_stats_sub(malloc_usable_size(ptr));
+        __libc_free(ptr);
+}
+
+void alloc_stats_begin(struct AllocStats *mark)
+{
+        alloc_stats.peak = alloc_stats.live;
+        *mark = alloc_stats;
+}
+
+void alloc_stats_report(const char *what, const struct AllocStats *mark)
+{
+        fprintf(stderr, "alloc %-20s %6ld allocations %10zu peak bytes\n",
+                what, alloc_stats.count - mark->count, alloc_stats.peak - mark->live);
+}
+
+#define ALLOC_STATS_BEGIN(mark)        struct AllocStats mark; alloc_stats_begin(&mark)
+#define ALLOC_STATS_REPORT(what, mark) alloc_stats_report(what, &mark)
+#else
+#define ALLOC_STATS_BEGIN(mark)        do {} while (0)
+#define ALLOC_STATS_REPORT(what, mark) do {} while (0)
+#endif
+
+// per run bump allocator, everything of the run goes back at once in arena_destroy.
+// the first block lives inside the arena itself, so a usual run never reaches malloc,
+// a request that does not fit chains a heap block
+#define ARENA_INLINE_SIZE 8192
+#define ARENA_ALIGN       16
+
+struct Arena {
+        char *data;
+        size_t len;
+        size_t cap;
+        void *blocks; // heap blocks, each starts with the pointer to the previous one
+        _Alignas(ARENA_ALIGN) char inline_data[ARENA_INLINE_SIZE];
+};
+
+void arena_init(struct Arena *arena)
+{
+        arena->data = arena->inline_data;
+        arena->len = 0;
+        arena->cap = sizeof(arena->inline_data);
+        arena->blocks = NULL;
+}
+
+void *arena_alloc(struct Arena *arena, size_t size)
+{
+        size_t offset = (arena->len + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+        if (offset + size > arena->cap) {
+                size_t cap = MAX(size, ARENA_INLINE_SIZE * 4);
+                char *block = malloc(ARENA_ALIGN + cap);
+                if (block == NULL)
+                        fatal("ERROR: arena_alloc block malloc fail");
+                *(void **)block = arena->blocks;
+                arena->blocks = block;
+                arena->data = block + ARENA_ALIGN;
+                arena->cap = cap;
+                offset = 0;
+        }
+        arena->len = offset + size;
+        return arena->data + offset;
+}
+
+char *arena_strndup(struct Arena *arena, const char *s, size_t len)
+{
+        char *copy = arena_alloc(arena, len + 1);
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+        return copy;
+}
+
+void arena_destroy(struct Arena *arena)
+{
+        while (arena->blocks != NULL) {
+                void *prev = *(void **)arena->blocks;
+                free(arena->blocks);
+                arena->blocks = prev;
+        }
+        arena_init(arena);
+}
+
 bool is_flag(const char *arg)
 {
         return strlen(arg) >= 2 && arg[0] == '-' && (arg[1] != ' ' && !(arg[1] >= '0' && arg[1] <= '9'));
@@ -61,8 +340,32 @@ long str_to_long(const char *s, int base)
         return l;
 }
 
+// next blank separated token of *s, s itself is not modified, false when there is none left
+bool next_token(const char **s, const char **token, size_t *len)
+{
+        *s += strspn(*s, " \t");
+        if (**s == '\0')
+                return false;
+        *token = *s;
+        *len = strcspn(*s, " \t");
+        *s += *len;
+        return true;
+}
+
+#define FNV_OFFSET 14695981039346656037ull
+
+// 64 bit fnv-1a, chain calls by passing the previous hash, start with FNV_OFFSET
+uint64_t fnv1a(uint64_t hash, const void *data, size_t len)
+{
+        const unsigned char *p = data;
+        for (size_t i = 0; i < len; ++i)
+                hash = (hash ^ p[i]) * 1099511628211ull;
+        return hash;
+}
+
 void write_to_clipboard(char *content)
 {
+        TRACE_BEGIN(span, "write_to_clipboard");
 #ifdef __linux__
         FILE *pipe = popen("xclip -selection clipboard", "w");
 #elif __APPLE__
@@ -79,26 +382,28 @@ void write_to_clipboard(char *content)
                 printf("ERROR: write_to_clipboard pclose fail\n");
                 exit(1);
         }
+        TRACE_END(span);
 }
 
-int get_config_file_line()
+int get_config_file_line(const unsigned char *txt, unsigned int txt_len)
 {
         int count = 1;
-        for (unsigned int i = 0; i < config_txt_len; ++i) {
-                if (config_txt[i] == '\n') count++;
+        for (unsigned int i = 0; i < txt_len; ++i) {
+                if (txt[i] == '\n') count++;
         }
         return count;
 }
 
-char *decimal_to_binary(const char *s)
+// out should hold NUMBER_STR_SIZE, return out
+char *decimal_to_binary(const char *s, char *out, size_t size)
 {
+        TRACE_BEGIN(span, "decimal_to_binary");
         long decimal = str_to_long(s, 10);
         bool is_neg = false;
-        char *ret = malloc(128);
-        if (!ret)
-                fatal("ERROR: decimal_to_binary ret malloc fail");
+        char *ret = out;
         if (decimal == 0) {
-                strcpy(ret, "0 (length: 1)");
+                snprintf(ret, size, "0 (length: 1)");
+                TRACE_END(span);
                 return ret;
         } else if (decimal < 0) {
                 is_neg = true;
@@ -153,22 +458,22 @@ char *decimal_to_binary(const char *s)
                 if (n_written == first_group || (n_written > first_group && (n_written - first_group) % 8 == 0))
                         *p++ = ' ';
         }
-        sprintf(p, "(length: %d)", len);
+        snprintf(p, size - (p - ret), "(length: %d)", len);
+        TRACE_END(span);
         return ret;
 }
 
-char *decimal_to_hex(const char *s)
+char *decimal_to_hex(const char *s, char *hex, size_t size)
 {
+        TRACE_BEGIN(span, "decimal_to_hex");
         long decimal = str_to_long(s, 10);
         bool is_neg = false;
-        char *hex = malloc(128);
-        if (hex == NULL)
-                fatal("ERROR: decimal_to_hex ret malloc fail");
         if (decimal < 0) {
                 is_neg = true;
                 decimal = -decimal;
         }
-        sprintf(hex, is_neg ? "-0x%lx" : "0x%lx", decimal);
+        snprintf(hex, size, is_neg ? "-0x%lx" : "0x%lx", decimal);
+        TRACE_END(span);
         return hex;
 }
 
@@ -178,13 +483,12 @@ long binary_to_decimal(const char *s)
         return str_to_long(s + 2, 2); // trim the prefix
 }
 
-char *binary_to_hex(const char *s)
+char *binary_to_hex(const char *s, char *hex, size_t size)
 {
+        TRACE_BEGIN(span, "binary_to_hex");
         long decimal = str_to_long(s + 2, 2); // trim the prefix
-        char *hex = malloc(128);
-        if (hex == NULL)
-                fatal("ERROR: binary_to_hex ret malloc fail");
-        sprintf(hex, "0x%lx", decimal);
+        snprintf(hex, size, "0x%lx", decimal);
+        TRACE_END(span);
         return hex;
 }
 
@@ -194,41 +498,35 @@ long hex_to_decimal(const char *s)
         return str_to_long(s + 2, 16); // trim the prefix
 }
 
-char *hex_to_binary(const char *s)
+char *hex_to_binary(const char *s, char *out, size_t size)
 {
+        TRACE_BEGIN(span, "hex_to_binary");
         long decimal = str_to_long(s + 2, 16); // trim the prefix
         char decimal_str[64];
         sprintf(decimal_str, "%ld", decimal);
-        return decimal_to_binary(decimal_str);
+        char *binary = decimal_to_binary(decimal_str, out, size);
+        TRACE_END(span);
+        return binary;
 }
 
-void print_n_char(char c, size_t n)
+char *second_to_formattime(long second, char *buf, size_t size)
 {
-        for (size_t i = 0; i < n; ++i)
-                putc(c, stdout);
-}
-
-char *second_to_formattime(long second)
-{
-        char *buf = malloc(128);
-        if (buf == NULL)
-                fatal("ERROR: second_to_formattime buf malloc fail");
         long h = second / 3600;
         long m = (second / 60) % 60;
         long s = second % 60;
         if (h > 0) {
-                sprintf(buf, ANSI_COLOR_YELLOW "session last: %ld hours, %ld minutes, %ld seconds" ANSI_COLOR_RESET, h, m, s);
+                snprintf(buf, size, ANSI_COLOR_YELLOW "session last: %ld hours, %ld minutes, %ld seconds" ANSI_COLOR_RESET, h, m, s);
         } else if (m > 0) {
-                sprintf(buf, ANSI_COLOR_YELLOW "session last: %ld minutes, %ld seconds" ANSI_COLOR_RESET, m, s);
+                snprintf(buf, size, ANSI_COLOR_YELLOW "session last: %ld minutes, %ld seconds" ANSI_COLOR_RESET, m, s);
         } else {
-                sprintf(buf, ANSI_COLOR_YELLOW "session last: %ld seconds" ANSI_COLOR_RESET, s);
+                snprintf(buf, size, ANSI_COLOR_YELLOW "session last: %ld seconds" ANSI_COLOR_RESET, s);
         }
         return buf;
 }
 
 struct ScpInfo {
-        char *port;
-        char *host;
+        char port[16];
+        char host[256]; // user@host:~
 };
 
 struct ConfigItem {
@@ -240,124 +538,191 @@ struct ConfigItem {
 struct Config {
         int len;
         struct ConfigItem *items;
+        char *strings;               // every name, key and value, NUL terminated one after another
+        struct ConfigItem **by_name; // sorted by name, built on the first prefix query
+        struct FuzzyIndex *fuzzy;    // trigram index, built on the first fuzzy query
+};
+
+struct App;
+struct Action;
+struct FuzzyIndex;
+
+enum TableColumn {
+        TABLE_COLUMN_NAME,
+        TABLE_COLUMN_KEY,
+        TABLE_COLUMN_VALUE,
+        TABLE_COLUMN_COUNT,
+};
+
+enum TableFormat {
+        TABLE_FORMAT_TABLE,
+        TABLE_FORMAT_TSV,
+        TABLE_FORMAT_JSON,
+};
+
+// how kit -c renders the config, zero value shows every row and column as a table
+struct TableOptions {
+        const char *filter;  // rows whose name or key contains it, ignoring case
+        enum TableColumn columns[TABLE_COLUMN_COUNT];
+        int columns_len;     // 0 for every column
+        enum TableFormat format;
+        bool no_pager;       // server request, a pager would read keys from the server's terminal
+};
+
+enum FlagArity {
+        FLAG_NO_VALUE,
+        FLAG_ONE_VALUE,
+        FLAG_VALUES, // one or more, until the next flag
+        FLAG_REST,   // zero or more, everything after it even if it looks like a flag
+        FLAG_VALUE_REST, // one, then optionally -- and everything after it
+};
+
+enum FlagId {
+        FLAG_HELP,
+        FLAG_CONFIG,
+        FLAG_CONFIG_VALUE,
+        FLAG_QUERY_BATCH,
+        FLAG_QUERY_LOAD,
+        FLAG_QUERY_SNIFF_SHAKE,
+        FLAG_QUERY_DUMP,
+        FLAG_QUERY_WASH,
+        FLAG_QUERY_LINE,
+        FLAG_QUERY_TIME,
+        FLAG_TIMESTAMP,
+        FLAG_NUMBER,
+        FLAG_CALC,
+        FLAG_SSH,
+        FLAG_SCP,
+        FLAG_STATS,
+        FLAG_SERVE,
+        FLAG_COMPLETE,
+        FLAG_COMPLETION,
+        FLAG_PICK,
+        FLAG_FILTER,
+        FLAG_COLUMNS,
+        FLAG_FORMAT,
+        FLAG_CACHE,
+        FLAG_COUNT,
+};
+
+struct Flag {
+        const char *short_name; // NULL if there is only long name
+        const char *long_name;
+        enum FlagArity arity;
+        void (*apply)(struct App *app, char *value);           // option, applied while parsing
+        void (*run)(struct App *app, struct Action *action);   // action, run in argument order
+        const char *help;
+};
+
+struct Action {
+        const struct Flag *flag;
+        char **args; // points into argv
+        int args_len;
 };
 
 struct App {
-        bool config_print;
-        char *config_query_name;
-
-        bool db_print_batch;
-        bool db_print_load;
-        bool db_print_sniff_and_shake;
-        bool db_print_dump;
-        bool db_print_wash;
         char *db_query_line;
         char *db_query_time;
+        char db_query_time_now[32];
+        bool pick; // a missed config name takes the single best fuzzy match
+        struct TableOptions table;
+        long cache_ttl; // seconds a remote command result is reused, 0 for no cache
+        int exit_code;  // of the process, EXIT_FAILURE once a remote command fails
+
+        struct Action *actions;
+        int actions_len;
+
+        struct Config *config;  // parsed on first use, shared by every action
+        char *clipboard;        // content of every action, written once after the last one
+        size_t clipboard_len;
+        size_t clipboard_cap;
 
-        char *timestamp;            // could be unix timestamp 1761272902 and formatted time "2025-09-12 12:30:21"
-        char *ssh_with_config_name; // ssh with config's name
-        char *number;
-        char **calculator_args;     // use NULL termitor otherwise need to track it's length
-        char **scp_args;            // same as above
+        struct Arena arena;     // memory of this run: actions, clipboard, spawned argv
 };
 
-struct ScpInfo *scp_info_init(char *ssh_config_key)
+void scp_info_init(const char *ssh_config_key, struct ScpInfo *si)
 {
-        struct ScpInfo *si = calloc(1, sizeof(*si));
-        if (si == NULL)
-                fatal("ERROR: scp_info_init si calloc fail");
-        // since strtok munipulate original ssh_config_key, when print the error message with ssh_config_key, need to use this instead
-        char *log_str = strdup(ssh_config_key);
+        si->host[0] = '\0';
+        si->port[0] = '\0';
         bool is_prev_port_flag = false;
-        for (char *token = strtok(ssh_config_key, " \t"); token != NULL; token = strtok(NULL, " \t")) {
-                if (strchr(token, '@') != NULL) {
-                        char *host = malloc(strlen(token) + 8);
-                        if (host == NULL)
-                                fatal("ERROR: scp_info_init host malloc fail");
-                        strcpy(host, token);
-                        strcat(host, ":~");
-                        si->host = host;
-                } else if (strcmp(token, "-p") == 0) {
+        const char *rest = ssh_config_key;
+        const char *token;
+        size_t len;
+        while (next_token(&rest, &token, &len)) {
+                if (memchr(token, '@', len) != NULL) {
+                        if (len + 3 > sizeof(si->host))
+                                fatal("ERROR: host too long in ssh config key: %s", ssh_config_key);
+                        snprintf(si->host, sizeof(si->host), "%.*s:~", (int)len, token);
+                } else if (len == 2 && strncmp(token, "-p", 2) == 0) {
                         is_prev_port_flag = true;
-                } else if (si->port == NULL && is_prev_port_flag) {
-                        if (is_flag(token))
-                                fatal("ERROR: not provide value for scp port flag: %s", log_str);
-                        if (!is_num_str(token))
-                                fatal("ERROR: invalid format for scp port flag: %s", token);
-                        si->port = strdup(token);
+                } else if (si->port[0] == '\0' && is_prev_port_flag) {
+                        if (len >= sizeof(si->port))
+                                fatal("ERROR: invalid format for scp port flag: %.*s", (int)len, token);
+                        snprintf(si->port, sizeof(si->port), "%.*s", (int)len, token);
+                        if (is_flag(si->port))
+                                fatal("ERROR: not provide value for scp port flag: %s", ssh_config_key);
+                        if (!is_num_str(si->port))
+                                fatal("ERROR: invalid format for scp port flag: %s", si->port);
                 }
         }
-        if (si->host == NULL)
-                fatal("ERROR: could not find host in ssh config key: %s", log_str);
-        if (si->port == NULL)
-                si->port = strdup("22");
-        free(log_str);
-        return si;
+        if (si->host[0] == '\0')
+                fatal("ERROR: could not find host in ssh config key: %s", ssh_config_key);
+        if (si->port[0] == '\0')
+                snprintf(si->port, sizeof(si->port), "22");
 }
 
-void scp_info_destory(struct ScpInfo *si)
-{
-        if (si->host)
-                free(si->host);
-        if (si->port)
-                free(si->port);
-        free(si);
-}
-
-struct Config *config_init()
+// txt is not NUL terminated(xxd -i output), so only walk it by txt_len.
+// three allocations whatever the size: config, items and one block for every string
+struct Config *config_init_from(const unsigned char *txt, unsigned int txt_len)
 {
+        TRACE_BEGIN(span, "config_init");
         struct Config *config = calloc(1, sizeof(struct Config));
         if (config == NULL)
                 fatal("ERROR: config_init config calloc fail");
-        struct ConfigItem *items = calloc(get_config_file_line(), sizeof(struct ConfigItem));
+        struct ConfigItem *items = calloc(get_config_file_line(txt, txt_len), sizeof(struct ConfigItem));
         if (items == NULL)
                 fatal("ERROR: config_init items calloc fail");
         config->items = items;
+        // an element with its NUL never takes more than its brackets, so txt_len is enough
+        char *strings = malloc(txt_len + 1);
+        if (strings == NULL)
+                fatal("ERROR: config_init strings malloc fail");
+        config->strings = strings;
         unsigned int advance_len = 0;
-        char *line_start = (char*)config_txt;
-        while (advance_len < config_txt_len) {
-                char *line_end = strchr(line_start, '\n');
+        char *line = (char*)txt;
+        while (advance_len < txt_len) {
+                char *line_end = memchr(line, '\n', txt_len - advance_len);
                 int line_len;
                 if (line_end)
-                        line_len = line_end - line_start;
+                        line_len = line_end - line;
                 else // last line
-                        line_len = (char*)(config_txt + config_txt_len) - line_start;
-                char *line = calloc(1, line_len + 1);
-                if (line == NULL)
-                        fatal("ERROR: config_init line calloc fail");
-                memcpy(line, line_start, line_len);
-                line_start = line_end + 1;
+                        line_len = (char*)(txt + txt_len) - line;
+                char *line_start = line;
+                line = line_end + 1;
                 advance_len += (line_len + 1);
                 int first = 0;
-                while (line[first] == ' ' || line[first] == '\t')
+                while (first < line_len && (line_start[first] == ' ' || line_start[first] == '\t'))
                         first++;
-                if (line[first] == '#') {
-                        free(line);
+                if (first < line_len && line_start[first] == '#')
                         continue;
-                }
                 char *elements[3] = {NULL};
                 int element_count = 0; // config item should have three elements([name] [key] [value])
                 char *start = NULL;
-                char *end = NULL;
                 for (int i = 0; i < line_len; ++i) {
-                        switch (line[i]) {
+                        switch (line_start[i]) {
                         case '[':
                                 if (start != NULL)
-                                        fatal("ERROR: invalid line in config file: %s", line);
-                                start = line + i;
+                                        fatal("ERROR: invalid line in config file: %.*s", line_len, line_start);
+                                start = line_start + i;
                                 break;
                         case ']':
-                                if (start == NULL)
-                                        fatal("ERROR: invalid line in config file: %s", line);
-                                end = line + i;
-                                size_t len = end - start;
-                                char *element = calloc(len, sizeof(char));
-                                if (element == NULL)
-                                        fatal("ERROR: config_init element calloc fail");
-                                memcpy(element, start+1, len-1);
-                                if (element_count >= 3)
-                                        fatal("ERROR: invalid line in config file: %s", line);
-                                elements[element_count++] = element;
+                                if (start == NULL || element_count >= 3)
+                                        fatal("ERROR: invalid line in config file: %.*s", line_len, line_start);
+                                size_t len = line_start + i - start - 1;
+                                memcpy(strings, start + 1, len);
+                                strings[len] = '\0';
+                                elements[element_count++] = strings;
+                                strings += len + 1;
                                 start = NULL;
                                 break;
                         default:
@@ -365,515 +730,2502 @@ struct Config *config_init()
                         }
                 }
                 if (element_count != 3)
-                        fatal("ERROR: invalid line in config file: %s", line);
+                        fatal("ERROR: invalid line in config file: %.*s", line_len, line_start);
                 config->items[config->len].name = elements[0];
                 config->items[config->len].key = elements[1];
                 config->items[config->len].value = elements[2];
                 config->len++;
-                free(line);
         }
+        TRACE_END(span);
         return config;
 }
 
-void config_print(struct Config *config)
+struct Config *config_init()
 {
-        if (config->len == 0) {
-                printf("ERROR: no config was found, should be installed with config.txt(format: [name] [key] [value]).\n");
-                return;
-        }
-        size_t column_len[3] = {
-                strlen(config->items[0].name),
-                strlen(config->items[0].key),
-                strlen(config->items[0].value)
-        };
-        for (int i = 1; i < config->len; ++i) {
-                column_len[0] = MAX(column_len[0], strlen(config->items[i].name));
-                column_len[1] = MAX(column_len[1], strlen(config->items[i].key));
-                column_len[2] = MAX(column_len[2], strlen(config->items[i].value));
-        }
-        // for left && right padding
-        column_len[0] += 4;
-        column_len[1] += 4;
-        column_len[2] += 4;
-        char *header[3] = { "name", "key", "value" };
-        char *vertical_separator = "¦";
-        size_t width = column_len[0] + column_len[1] + column_len[2] + 4; // 4 "|"
-        print_n_char('-', width);
-        printf("\n");
-        // print header
-        for (int i = 0; i < 3; ++i) {
-                size_t left_padding = (column_len[i] - strlen(header[i])) / 2;
-                size_t right_apdding = column_len[i] - left_padding - strlen(header[i]);
-                printf("%s", vertical_separator);
-                print_n_char(' ', left_padding);
-                printf("%s", ANSI_COLOR_YELLOW); 
-                printf("%s", header[i]);
-                printf("%s", ANSI_COLOR_RESET); 
-                print_n_char(' ', right_apdding);
-                if (i == 2)
-                        printf("%s\n", vertical_separator);
-        }
-        // print content
-        for (int i = 0; i < config->len; ++i) {
-                print_n_char('-', width);
-                printf("\n");
-                for (int j = 0; j < 3; ++j) {
-                        char *element;
-                        if (j == 0)
-                                element = config->items[i].name;
-                        else if (j == 1)
-                                element = config->items[i].key;
-                        else
-                                element = config->items[i].value;
-                        size_t element_len = strlen(element);
-                        size_t left_padding = (column_len[j] - element_len) / 2;
-                        size_t right_padding = column_len[j] - left_padding - element_len;
-                        printf("%s", vertical_separator);
-                        print_n_char(' ', left_padding);
-                        if (j == 2)
-                                print_n_char('*', element_len);
-                        else
-                                printf("%s", element);
-                        print_n_char(' ', right_padding);
-                        if (j == 2)
-                                printf("%s\n", vertical_separator);
-                }
-                if (i == config->len - 1) {
-                        print_n_char('-', width);
-                        printf("\n");
-                }
-        }
+        return config_init_from(config_txt, config_txt_len);
 }
 
-void config_destroy(struct Config *config)
+// return index of the item named name, -1 if not exist
+int config_find(struct Config *config, const char *name)
 {
         for (int i = 0; i < config->len; ++i) {
-                free(config->items[i].name);
-                free(config->items[i].key);
-                free(config->items[i].value);
+                if (strcmp(name, config->items[i].name) == 0)
+                        return i;
         }
-        free(config->items);
-        free(config);
+        return -1;
 }
 
+bool config_item_is_ssh(struct ConfigItem *item)
+{
+        return strstr(item->key, "ssh") != NULL;
+}
 
-struct App *app_init(int argc, char **argv)
+int config_item_name_cmp(const void *a, const void *b)
 {
-        struct App *app = calloc(1, sizeof(*app));
-        if (app == NULL)
-                fatal("ERROR: app_init app calloc fail");
-        // first loop search for help flag
-        for (int i = 1; i < argc; i++) {
-                if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
-                        printf("OPTIONS:\n");
-                        printf("    -h,   --help,             show this help message\n");
-                        printf("    -c,   --config            show <exist_config_name>\n");
-                        printf("    -cv,  --config_vlaue      get config value by <exist_config_name>\n");
-                        printf("    -qb,  --query_batch       show query for batch\n");
-                        printf("    -ql,  --query_load        show query for load\n");
-                        printf("    -qss, --query_sniff_shake show query for sniff and shake\n");
-                        printf("    -qd,  --query_dump        show query for dump\n");
-                        printf("    -qw,  --query_wash        show qeury for wash\n");
-                        printf("    -qln, --query_line        1|2|3|4, default is 3\n");
-                        printf("    -qt,  --query_time        2025-09-12 12:30:21, default is now\n");
-                        printf("    -t,   --timestamp         1757651421 -> 2025-09-12 12:30:21, vice versa\n");
-                        printf("    -n,   --number            decimal, binary(0b or 0B prefix), hex(0x or 0X prefix) transfer to one another\n");
-                        printf("    -C,   --calc              wrapper caulucator above bc, in zsh when use multiply('*') need to be quoted, so support replace 'x' for '*', 2x3 <==> 2*3 \n");
-                        printf("    -ssh, --ssh               kit -ssh <exist_config_name>\n");
-                        printf("    -scp, --scp               kit -scp <foo_dir> <bar_dir> <exist_config_name>\n");
-                        exit(EXIT_SUCCESS);
-                }
-        }
-        // next loop do the init work
-        int i = 1;
-        while (i < argc) {
-                char *flag = argv[i++];
-                if (flag[0] != '-')
-                        fatal("ERROR: invalid flag: %s", flag);
-                if (strcmp(flag, "-c") == 0 || strcmp(flag, "--config") == 0) {
-                        app->config_print = true;
-                } else if (strcmp(flag, "-qb") == 0 || strcmp(flag, "--query_batch") == 0) {
-                        app->db_print_batch = true;
-                } else if (strcmp(flag, "-ql") == 0 || strcmp(flag, "--query_load") == 0) {
-                        app->db_print_load = true;
-                } else if (strcmp(flag, "-qss") == 0 || strcmp(flag, "--query_sniff_shake") == 0) {
-                        app->db_print_sniff_and_shake = true;
-                } else if (strcmp(flag, "-qd") == 0 || strcmp(flag, "--query_dump") == 0) {
-                        app->db_print_dump = true;
-                } else if (strcmp(flag, "-qw") == 0 || strcmp(flag, "--query_wash") == 0) {
-                        app->db_print_wash = true;
-                } else if (strcmp(flag, "-C") == 0 || strcmp(flag, "--calc") == 0) {
-                        if (i == argc)
-                                fatal("ERROR: flag(%s) not provide value", flag);
-                        char *first_arg = argv[i++];
-                        if (is_flag(first_arg))
-                                fatal("ERROR: flag(%s) not provide value", flag);
-                        char **calculator_args = calloc(1, sizeof(*calculator_args) * 128);
-                        if (!calculator_args)
-                                fatal("ERROR: app_init calculator_args calloc fail");
-                        int len = 0;
-                        calculator_args[len++] = strdup(first_arg);
-                        for (; i < argc && !is_flag(argv[i]); ++i) {
-                                calculator_args[len++] = strdup(argv[i]);
-                        }
-                        // support 'x' -> '*'
-                        for (int j = 0; j < len; ++j) {
-                                char *x = NULL;
-                                do {
-                                        x = strchr(calculator_args[j], 'x');
-                                        if (x != NULL)
-                                                *x = '*';
-                                } while (x != NULL);
-                        }
-                        app->calculator_args = calculator_args;
-                } else if (strcmp(flag, "-scp") == 0 || strcmp(flag, "--scp") == 0) {
-                        if (i == argc)
-                                fatal("ERROR: flag(%s) not provide value", flag);
-                        char *first_arg = argv[i++];
-                        if (is_flag(first_arg))
-                                fatal("ERROR: flag(%s) not provide value", flag);
-                        char **scp_args = calloc(1, sizeof(*scp_args) * 128);
-                        if (!scp_args)
-                                fatal("ERROR: app_init scp_args calloc fail");
-                        int len = 0;
-                        scp_args[len++] = strdup(first_arg);
-                        for (; i < argc && !is_flag(argv[i]); ++i) {
-                                scp_args[len++] = strdup(argv[i]);
-                        }
-                        app->scp_args = scp_args;
-                } else {
-                        if (i == argc)
-                                fatal("ERROR: flag(%s) not provide value", flag);
-                        if (strcmp(flag, "-cv") == 0 || strcmp(flag, "--config_value") == 0) {
-                                app->config_query_name = strdup(argv[i++]);
-                        } else if (strcmp(flag, "-qln") == 0 || strcmp(flag, "--query_line") == 0) {
-                                app->db_query_line = strdup(argv[i++]);
-                        } else if (strcmp(flag, "-qt") == 0 || strcmp(flag, "--query_time") == 0) {
-                                app->db_query_time = strdup(argv[i++]);
-                        } else if (strcmp(flag, "-t") == 0 || strcmp(flag, "--timestamp") == 0) {
-                                app->timestamp = strdup(argv[i++]);
-                        } else if (strcmp(flag, "-ssh") == 0 || strcmp(flag, "--ssh") == 0) {
-                                app->ssh_with_config_name = strdup(argv[i++]);
-                        } else if (strcmp(flag, "-n") == 0 || strcmp(flag, "--number") == 0) {
-                                app->number = strdup(argv[i++]);
-                        }
-                }
-        }
-        if (!app->db_query_line) app->db_query_line = strdup("3");
-        if (!app->db_query_time) {
-                char now_string[32] = {0};
-                time_t now = time(NULL);
-                struct tm *time = localtime(&now);
-                strftime(now_string, sizeof(now_string), "%Y-%m-%d %H:%M:%S", time);
-                app->db_query_time = strdup(now_string);
-        }
-        return app;
+        return strcmp((*(struct ConfigItem *const *)a)->name, (*(struct ConfigItem *const *)b)->name);
 }
 
-void app_run(struct App *app)
+struct ConfigItem **config_by_name(struct Config *config)
 {
-        if (app->config_print) {
-                struct Config *config = config_init();
-                config_print(config);
-                config_destroy(config);
-                return;
-        }
-        if (app->config_query_name) {
-                struct Config *config = config_init();
-                for (int i = 0; i < config->len; ++i) {
-                        if (strcmp(app->config_query_name, config->items[i].name) == 0) {
-                                printf("%s\n", config->items[i].value);
-                                write_to_clipboard(config->items[i].value);
-                                return;
-                        }
-                }
-                printf("ERROR: name '%s' not found in config.", app->config_query_name);
-                if (config->len > 0) {
-                        printf("\nExist config: ");
-                        for (int i = 0; i < config->len; ++i)
-                                printf("[%s]", config->items[i].name);
-                        putc('\n', stdout);
-                } else {
-                        printf(" No config was found, should be installed with config.txt\n");
-                }
-                return;
-        }
-        if (app->db_print_batch) {
-                char *query = "SELECT equipment_code, is_end, created_at FROM production_batch order by id desc;";
-                printf("%s\n", query);
-                write_to_clipboard(query);
-                return;
-        }
-        if (app->db_print_load) {
-                char query[256];
-                sprintf(query, "SELECT cid, load, alarm_at FROM alarm WHERE equipment_code = '%s线' AND load = true AND alarm_at < '%s' ORDER BY id DESC LIMIT 100;", app->db_query_line, app->db_query_time);
-                printf("%s\n", query);
-                write_to_clipboard(query);
-                return;
+        if (config->by_name == NULL) {
+                config->by_name = malloc(sizeof(*config->by_name) * MAX(config->len, 1));
+                if (config->by_name == NULL)
+                        fatal("ERROR: config_by_name by_name malloc fail");
+                for (int i = 0; i < config->len; ++i)
+                        config->by_name[i] = &config->items[i];
+                qsort(config->by_name, config->len, sizeof(*config->by_name), config_item_name_cmp);
         }
-        if (app->db_print_sniff_and_shake) {
-                char query1[256];
-                char query2[256];
-                sprintf(query1, "SELECT cid, sniff, alarm_at FROM alarm WHERE equipment_code = '%s线' and sniff = true AND alarm_at < '%s' ORDER BY id DESC LIMIT 100;", app->db_query_line, app->db_query_time);
-                sprintf(query2, "SELECT cid, shake, alarm_at FROM alarm WHERE equipment_code = '%s线' AND shake = true AND alarm_at < '%s' ORDER BY id DESC LIMIT 100;", app->db_query_line, app->db_query_time);
-                printf("%s\n%s\n", query1, query2);
-                write_to_clipboard(query1);
-                return;
+        return config->by_name;
+}
+
+// items whose name starts with prefix in name order, binary search for the first then walk
+struct ConfigItem **config_prefix(struct Config *config, const char *prefix, int *count)
+{
+        struct ConfigItem **by_name = config_by_name(config);
+        size_t prefix_len = strlen(prefix);
+        int low = 0;
+        int high = config->len;
+        while (low < high) {
+                int mid = low + (high - low) / 2;
+                if (strcmp(by_name[mid]->name, prefix) < 0)
+                        low = mid + 1;
+                else
+                        high = mid;
         }
-        if (app->db_print_dump) {
-                char query[256];
-                sprintf(query, "SELECT cid, dump, alarm_at, package_type FROM alarm WHERE equipment_code = '%s线' AND dump = true AND alarm_at < '%s' ORDER BY id DESC LIMIT 100;", app->db_query_line, app->db_query_time);
-                printf("%s\n", query);
-                write_to_clipboard(query);
-        }
-        if (app->db_print_wash) {
-                char query[256];
-                sprintf(query, "SELECT cid, wash, alarm_at, package_type FROM alarm WHERE equipment_code = '%s线' AND wash = true AND alarm_at < '%s' ORDER BY id DESC LIMIT 100;", app->db_query_line, app->db_query_time);
-                printf("%s\n", query);
-                write_to_clipboard(query);
-                return;
+        int end = low;
+        while (end < config->len && strncmp(by_name[end]->name, prefix, prefix_len) == 0)
+                end++;
+        *count = end - low;
+        return by_name + low;
+}
+
+// fuzzy lookup of config names for misses: a trigram index picks candidates sharing the most
+// trigrams with the query, only those are ranked(prefix, substring, subsequence, then bounded
+// edit distance), so a query does not touch every name
+#define FUZZY_BUCKETS     65536
+#define FUZZY_MAX_LEN     255 // longer names are cut for matching
+#define FUZZY_CANDIDATES  64
+#define FUZZY_SUGGESTIONS 5
+
+struct FuzzyIndex {
+        int *offsets;  // postings of bucket b start at offsets[b]
+        int *ends;     // and end at ends[b], repeated trigrams of one name are stored once
+        int *postings; // item index
+        int *counts;   // scratch of one query, shared trigram count per item
+        int *touched;  // items with counts != 0
+};
+
+enum FuzzyRank {
+        FUZZY_PREFIX,
+        FUZZY_SUBSTRING,
+        FUZZY_SUBSEQUENCE,
+        FUZZY_EDIT,
+};
+
+struct FuzzyMatch {
+        int item;
+        int shared; // trigrams shared with the query
+        enum FuzzyRank rank;
+        int metric; // lower is better: name length, position, gaps or edit distance by rank
+        int name_len;
+};
+
+unsigned char fuzzy_lower(unsigned char c)
+{
+        return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+// trigram buckets of "  name ", the padding gives short names and word starts trigrams as well
+int fuzzy_trigrams(const char *s, unsigned *buckets)
+{
+        unsigned char padded[FUZZY_MAX_LEN + 3];
+        size_t len = MIN(strlen(s), FUZZY_MAX_LEN);
+        padded[0] = ' ';
+        padded[1] = ' ';
+        for (size_t i = 0; i < len; ++i)
+                padded[i + 2] = fuzzy_lower(s[i]);
+        padded[len + 2] = ' ';
+        int n = 0;
+        for (size_t i = 0; i + 2 < len + 3; ++i) {
+                unsigned trigram = (unsigned)padded[i] << 16 | (unsigned)padded[i + 1] << 8 | padded[i + 2];
+                buckets[n++] = (trigram * 2654435761u) >> 16; // fibonacci hashing to 16 bits
         }
-        if (app->timestamp) {
-                bool is_epoch = true;
-                size_t len = strlen(app->timestamp);
-                for (size_t i = 0; i < len; ++i) {
-                        if (app->timestamp[i] == '-') {
-                                is_epoch = false;
-                                break;
-                        }
-                }
-                if (is_epoch && len != EPOCH_SECCOND_LEN && len != EPOCH_MILLISECOND_LEN)
-                        fatal("ERROR: invalid timestamp length, can only be 10(second) or 13(millisecond)");
-                if (is_epoch) {
-                        time_t epoch = (time_t)str_to_long(app->timestamp, 10);
-                        struct tm *broken_down_time = localtime(&epoch);
-                        char format_time[64];
-                        strftime(format_time, sizeof(format_time), "%Y-%m-%d %H:%M:%S", broken_down_time);
-                        printf("%s\n", format_time);
-                        write_to_clipboard(format_time);
-                } else {
-                        struct tm broken_down_time;
-                        char *rc = strptime(app->timestamp, "%Y-%m-%d %H:%M:%S", &broken_down_time);
-                        if (rc == NULL || *rc != '\0')
-                                fatal("ERROR: format time only support YYYY-MM-DD hh:mm:ss format(2025-11-12 11:33:22)");
-                        time_t epoch_second = mktime(&broken_down_time);
-                        char epoch_second_string[EPOCH_SECCOND_LEN+1] = {0};
-                        sprintf(epoch_second_string, "%ld", epoch_second);
-                        printf("%s\n", epoch_second_string);
-                        write_to_clipboard(epoch_second_string);
-                }
-                return;
+        return n;
+}
+
+// two counting passes over every name, no sort
+struct FuzzyIndex *config_fuzzy_index(struct Config *config)
+{
+        if (config->fuzzy != NULL)
+                return config->fuzzy;
+        struct FuzzyIndex *index = calloc(1, sizeof(*index));
+        if (index == NULL)
+                fatal("ERROR: config_fuzzy_index index calloc fail");
+        index->offsets = calloc(FUZZY_BUCKETS + 1, sizeof(*index->offsets));
+        index->ends = malloc(sizeof(*index->ends) * FUZZY_BUCKETS);
+        index->counts = calloc(MAX(config->len, 1), sizeof(*index->counts));
+        index->touched = malloc(sizeof(*index->touched) * MAX(config->len, 1));
+        if (!index->offsets || !index->ends || !index->counts || !index->touched)
+                fatal("ERROR: config_fuzzy_index alloc fail");
+        unsigned buckets[FUZZY_MAX_LEN + 1];
+        for (int i = 0; i < config->len; ++i) {
+                int n = fuzzy_trigrams(config->items[i].name, buckets);
+                for (int j = 0; j < n; ++j)
+                        index->offsets[buckets[j] + 1]++;
         }
-        if (app->number) {
-                char first_bit = app->number[0];
-                char second_bit = app->number[1];
-                long decimal;
-                char *binary = NULL;
-                char *hex = NULL;
-                if (first_bit == '0') {
-                        if (second_bit == 'b' || second_bit == 'B') {
-                                // binary
-                                decimal = binary_to_decimal(app->number);
-                                hex = binary_to_hex(app->number);
-                                printf("decimal -- %ld\n", decimal);
-                                printf("binary  -- %s\n", app->number);
-                                printf("hex     -- %s\n", hex);
-                                free(hex);
-                        } else if (second_bit == 'x' || second_bit == 'X') {
-                                // hex
-                                decimal = hex_to_decimal(app->number);
-                                binary = hex_to_binary(app->number);
-                                printf("decimal -- %ld\n", decimal);
-                                printf("binary  -- %s\n", binary);
-                                printf("hex     -- %s\n", app->number);
-                                free(binary);
-                        } else {
-                                fatal("unknown format: %s, only support decimal, binary(0b or 0B) and hex(0x or 0X)", app->number);
-                        }
-                } else {
-                        // decimal
-                        binary = decimal_to_binary(app->number);
-                        hex = decimal_to_hex(app->number);
-                        printf("decimal -- %s\n", app->number);
-                        printf("binary  -- %s\n", binary);
-                        printf("hex     -- %s\n", hex);
-                        free(binary);
-                        free(hex);
-                }
-                return;
+        for (int b = 0; b < FUZZY_BUCKETS; ++b) {
+                index->offsets[b + 1] += index->offsets[b];
+                index->ends[b] = index->offsets[b];
         }
-        if (app->calculator_args) {
-                size_t cmd_len = 16; // reserve length for bc <<< ""
-                for (int i = 0; app->calculator_args[i] != NULL; ++i)
-                        cmd_len += strlen(app->calculator_args[i]);
-                char *cmd = calloc(1, sizeof(*cmd) * cmd_len);
-                if (cmd == NULL)
-                        fatal("ERROR: app_run app->calculator_args cmd calloc fail");
-                strcat(cmd, "bc <<< \"");
-                for (int i = 0; app->calculator_args[i] != NULL; ++i)
-                        strcat(cmd, app->calculator_args[i]);
-                strcat(cmd, "\"");
-                FILE *pipe = popen(cmd, "r");
-                if (pipe == NULL)
-                        fatal("ERROR: app_run popen fail");
-                char buf[1024];
-                while (fgets(buf, sizeof(buf), pipe) != NULL) {
-                        printf(buf);
-                        buf[strlen(buf) - 1] = '\0'; // remove the new line character for clipboard
-                        write_to_clipboard(buf);
+        index->postings = malloc(sizeof(*index->postings) * MAX(index->offsets[FUZZY_BUCKETS], 1));
+        if (index->postings == NULL)
+                fatal("ERROR: config_fuzzy_index postings malloc fail");
+        for (int i = 0; i < config->len; ++i) {
+                int n = fuzzy_trigrams(config->items[i].name, buckets);
+                for (int j = 0; j < n; ++j) {
+                        int *end = &index->ends[buckets[j]];
+                        // items are added in order, so a repeat of this item can only be the last one
+                        if (*end > index->offsets[buckets[j]] && index->postings[*end - 1] == i)
+                                continue;
+                        index->postings[(*end)++] = i;
                 }
-                return;
         }
-        if (app->scp_args) {
-                struct Config *config = config_init();
-                int len = 0;
-                while (app->scp_args[len] != NULL) {
-                     len++;
-                }
-                if (len > 121)
-                        fatal("ERROR: too many argument in scp, only support upload up to 120 files");
-                int i = 0;
-                for (; i < config->len; i++) {
-                        if (strcmp(app->scp_args[len-1], config->items[i].name) == 0)
-                                break;
-                }
-                if (i == config->len) {
-                        printf("ERROR: can't find scp config name %s. Exist ssh config: ", app->scp_args[len-1]);
-                        bool once = false;
-                        for (int i = 0; i < config->len; ++i) {
-                                if (strstr(config->items[i].key, "ssh") != NULL) {
-                                        once = true;
-                                        printf("[%s]", config->items[i].name);
-                                }
-                        }
-                        if (!once)
-                                printf("NULL.");
-                        putc('\n', stdout);
-                        config_destroy(config);
-                        return;
-                }
-                struct timeval start;
-                struct timeval end;
-                int max_args = 128;
-                char **args = malloc(sizeof(*args) * (max_args+2)); // 1 for scp program and 1 for NULL terminator
-                if (!args) {
-                        config_destroy(config);
-                        fatal("ERROR: app_run scp args malloc fail");
-                }
-                struct ScpInfo *si = scp_info_init(config->items[i].key);
-                int args_len = 0;
-                args[args_len++] = strdup("scp");
-                args[args_len++] = strdup("-P");
-                args[args_len++] = strdup(si->port);
-                args[args_len++] = strdup("-r");
-                for (int i = 0; i < len - 1; ++i) {
-                        args[args_len++] = app->scp_args[i];
-                }
-                args[args_len++] = strdup(si->host);
-                scp_info_destory(si);
-                args[args_len++] = NULL;
-                write_to_clipboard(config->items[i].value);
-                gettimeofday(&start, NULL);
-                int rc = fork();
-                if (rc == -1)
-                        fatal("ERROR: app_run scp fork fail");
-                if (rc == 0) {
-                        execvp("scp", args);
-                        fatal("ERROR: scp fail: %s", strerror(errno));
+        config->fuzzy = index;
+        return index;
+}
+
+void fuzzy_index_destroy(struct FuzzyIndex *index)
+{
+        free(index->offsets);
+        free(index->ends);
+        free(index->postings);
+        free(index->counts);
+        free(index->touched);
+        free(index);
+}
+
+// edit distance of query to the part of name it matches best(start and end in name are free),
+// an adjacent transposition is one edit, ascii case is ignored. bound + 1 as soon as it must be larger
+int fuzzy_distance(const char *query, const char *name, int bound)
+{
+        int query_len = MIN(strlen(query), FUZZY_MAX_LEN);
+        int name_len = MIN(strlen(name), FUZZY_MAX_LEN);
+        int rows[3][FUZZY_MAX_LEN + 1];
+        int *before = rows[0];
+        int *prev = rows[1];
+        int *row = rows[2];
+        for (int j = 0; j <= name_len; ++j)
+                prev[j] = 0;
+        for (int i = 1; i <= query_len; ++i) {
+                unsigned char q = fuzzy_lower(query[i - 1]);
+                row[0] = i;
+                int row_min = row[0];
+                for (int j = 1; j <= name_len; ++j) {
+                        unsigned char n = fuzzy_lower(name[j - 1]);
+                        int d = MIN(MIN(prev[j] + 1, row[j - 1] + 1), prev[j - 1] + (q != n));
+                        if (i > 1 && j > 1 && q == fuzzy_lower(name[j - 2]) && fuzzy_lower(query[i - 2]) == n)
+                                d = MIN(d, before[j - 2] + 1);
+                        row[j] = d;
+                        row_min = MIN(row_min, d);
                 }
-                wait(NULL);
-                gettimeofday(&end, NULL);
-                char *formattime = second_to_formattime(end.tv_sec - start.tv_sec);
-                printf("%s\n", formattime);
-                free(formattime);
-                return;
+                if (row_min > bound)
+                        return bound + 1;
+                int *free_row = before;
+                before = prev;
+                prev = row;
+                row = free_row;
         }
-        if (app->ssh_with_config_name) {
-                struct timeval start;
-                struct timeval end;
-                struct Config *config = config_init();
-                int i = 0;
-                for (; i < config->len; i++) {
-                        if (strcmp(app->ssh_with_config_name, config->items[i].name) == 0)
-                                break;
-                }
-                if (i == config->len) {
-                        printf("ERROR: can't find ssh config name %s. Exist ssh config: ", app->ssh_with_config_name);
-                        bool once = false;
-                        for (int i = 0; i < config->len; ++i) {
-                                if (strstr(config->items[i].key, "ssh") != NULL) {
-                                        once = true;
-                                        printf("[%s]", config->items[i].name);
-                                }
-                        }
-                        if (!once)
-                                printf("NULL.");
-                        putc('\n', stdout);
-                        config_destroy(config);
-                        return;
-                }
-                int max_args = 128;
-                char **args = malloc(sizeof(*args) * (max_args + 2)); // 1 for ssh program and 1 for NULL terminator
-                if (!args) {
-                        config_destroy(config);
-                        fatal("ERROR: app_run ssh args malloc fail");
-                }
-                args[0] = strdup("ssh");
-                int index = 1;
-                char *token = strtok(config->items[i].key, " \t"); // first token is ssh, just ignore it
-                while (index < max_args) {
-                        token = strtok(NULL, " \t");
-                        if (token == NULL) {
-                                args[index] = NULL;
-                                break;
-                        }
-                        args[index++] = strdup(token);
-                }
-                write_to_clipboard(config->items[i].value);
-                config_destroy(config);
-                gettimeofday(&start, NULL);
-                int rc = fork();
-                if (rc == -1)
-                        fatal("ERROR: app_run ssh fork fail");
-                if (rc == 0) {
-                        execvp("ssh", args);
-                        fatal("ERROR: ssh fail: %s", strerror(errno));
+        int best = prev[0];
+        for (int j = 1; j <= name_len; ++j)
+                best = MIN(best, prev[j]);
+        return MIN(best, bound + 1);
+}
+
+// characters of name skipped between the first and last character of query, -1 if query is no subsequence
+int fuzzy_subsequence_gaps(const char *query, const char *name)
+{
+        int gaps = 0;
+        bool started = false;
+        for (; *name != '\0' && *query != '\0'; ++name) {
+                if (fuzzy_lower(*name) == fuzzy_lower(*query)) {
+                        started = true;
+                        query++;
+                } else if (started) {
+                        gaps++;
                 }
-                wait(NULL);
-                gettimeofday(&end, NULL);
-                char *formattime = second_to_formattime(end.tv_sec - start.tv_sec);
-                printf("%s\n", formattime);
-                free(formattime);
-                return;
         }
+        return *query == '\0' ? gaps : -1;
 }
 
-void app_destroy(struct App *app)
+// false if name is no match at all
+bool fuzzy_rank(const char *query, const char *name, struct FuzzyMatch *match)
 {
-        if (app->config_query_name)
-                free(app->config_query_name);
-        if (app->db_query_line)
-                free(app->db_query_line);
-        if (app->db_query_time)
-                free(app->db_query_time);
-        if (app->timestamp)
-                free(app->timestamp);
-        if (app->ssh_with_config_name)
-                free(app->ssh_with_config_name);
-        if (app->number)
-                free(app->number);
-        if (app->calculator_args) {
-                for (int i = 0; app->calculator_args[i] != NULL; ++i)
-                        free(app->calculator_args[i]);
-                free(app->calculator_args);
-        }
-        free(app);
+        size_t query_len = strlen(query);
+        match->name_len = strlen(name);
+        const char *found = strcasestr(name, query);
+        if (found == name) {
+                match->rank = FUZZY_PREFIX;
+                match->metric = match->name_len;
+        } else if (found != NULL) {
+                match->rank = FUZZY_SUBSTRING;
+                match->metric = found - name;
+        } else if ((match->metric = fuzzy_subsequence_gaps(query, name)) != -1) {
+                match->rank = FUZZY_SUBSEQUENCE;
+        } else {
+                int bound = MAX(1, (int)query_len / 3);
+                match->rank = FUZZY_EDIT;
+                match->metric = fuzzy_distance(query, name, bound);
+                if (match->metric > bound)
+                        return false;
+        }
+        return true;
 }
 
-int main(int argc, char **argv)
+int fuzzy_match_cmp(const void *a, const void *b)
 {
-        struct App *app = app_init(argc, argv);
-        app_run(app);
-        app_destroy(app);
-        return 0;
+        const struct FuzzyMatch *x = a;
+        const struct FuzzyMatch *y = b;
+        if (x->rank != y->rank)
+                return x->rank < y->rank ? -1 : 1;
+        if (x->metric != y->metric)
+                return x->metric < y->metric ? -1 : 1;
+        if (x->shared != y->shared)
+                return x->shared > y->shared ? -1 : 1;
+        if (x->name_len != y->name_len)
+                return x->name_len < y->name_len ? -1 : 1;
+        return x->item - y->item;
 }
+
+// best matches of query first, returns how many were written to matches
+int fuzzy_search(struct Config *config, const char *query, bool ssh_only, struct FuzzyMatch *matches, int max)
+{
+        struct FuzzyIndex *index = config_fuzzy_index(config);
+        unsigned buckets[FUZZY_MAX_LEN + 1];
+        int n = fuzzy_trigrams(query, buckets);
+        int touched_len = 0;
+        for (int i = 0; i < n; ++i) {
+                bool repeated = false;
+                for (int j = 0; j < i && !repeated; ++j)
+                        repeated = buckets[j] == buckets[i];
+                if (repeated)
+                        continue;
+                for (int p = index->offsets[buckets[i]]; p < index->ends[buckets[i]]; ++p) {
+                        int item = index->postings[p];
+                        if (index->counts[item]++ == 0)
+                                index->touched[touched_len++] = item;
+                }
+        }
+        // keep the FUZZY_CANDIDATES items sharing the most trigrams, sorted by count
+        struct FuzzyMatch candidates[FUZZY_CANDIDATES];
+        int candidates_len = 0;
+        for (int i = 0; i < touched_len; ++i) {
+                int item = index->touched[i];
+                int shared = index->counts[item];
+                index->counts[item] = 0; // reset scratch for the next query
+                if (ssh_only && !config_item_is_ssh(&config->items[item]))
+                        continue;
+                if (candidates_len == FUZZY_CANDIDATES && shared <= candidates[candidates_len - 1].shared)
+                        continue;
+                int j = candidates_len < FUZZY_CANDIDATES ? candidates_len++ : candidates_len - 1;
+                for (; j > 0 && candidates[j - 1].shared < shared; --j)
+                        candidates[j] = candidates[j - 1];
+                candidates[j] = (struct FuzzyMatch){ .item = item, .shared = shared };
+        }
+        int len = 0;
+        for (int i = 0; i < candidates_len; ++i) {
+                if (fuzzy_rank(query, config->items[candidates[i].item].name, &candidates[i]))
+                        candidates[len++] = candidates[i];
+        }
+        // insertion sort, qsort may take a heap buffer for this many bytes
+        for (int i = 1; i < len; ++i) {
+                struct FuzzyMatch match = candidates[i];
+                int j = i;
+                for (; j > 0 && fuzzy_match_cmp(&candidates[j - 1], &match) > 0; --j)
+                        candidates[j] = candidates[j - 1];
+                candidates[j] = match;
+        }
+        len = MIN(len, max);
+        memcpy(matches, candidates, sizeof(*matches) * len);
+        return len;
+}
+
+// the best match if no other name matches the same way, -1 otherwise.
+// edit distance is the only metric strong enough to tell two names apart
+int fuzzy_pick(struct Config *config, const char *query, bool ssh_only)
+{
+        struct FuzzyMatch matches[2];
+        int len = fuzzy_search(config, query, ssh_only, matches, 2);
+        if (len == 0)
+                return -1;
+        if (len == 2 && matches[0].rank == matches[1].rank && (matches[0].rank != FUZZY_EDIT || matches[0].metric == matches[1].metric))
+                return -1;
+        fprintf(stderr, "picked '%s' for '%s'\n", config->items[matches[0].item].name, query);
+        return matches[0].item;
+}
+
+void config_print_suggestions(struct Config *config, const char *query, bool ssh_only)
+{
+        struct FuzzyMatch matches[FUZZY_SUGGESTIONS];
+        int len = fuzzy_search(config, query, ssh_only, matches, FUZZY_SUGGESTIONS);
+        for (int i = 0; i < len; ++i)
+                printf("[%s]", config->items[matches[i].item].name);
+        if (len == 0)
+                printf("NULL.");
+        putc('\n', stdout);
+}
+
+// output built in memory and written at once, data is always NUL terminated
+struct Buffer {
+        char *data;
+        size_t len;
+        size_t cap;
+};
+
+void buffer_reserve(struct Buffer *buffer, size_t more)
+{
+        size_t need = buffer->len + more + 1;
+        if (need <= buffer->cap)
+                return;
+        size_t cap = MAX(need, MAX(buffer->cap * 2, 4096));
+        char *data = realloc(buffer->data, cap);
+        if (data == NULL)
+                fatal("ERROR: buffer_reserve data realloc fail");
+        buffer->data = data;
+        buffer->cap = cap;
+}
+
+void buffer_append(struct Buffer *buffer, const char *s, size_t len)
+{
+        buffer_reserve(buffer, len);
+        memcpy(buffer->data + buffer->len, s, len);
+        buffer->len += len;
+        buffer->data[buffer->len] = '\0';
+}
+
+void buffer_append_str(struct Buffer *buffer, const char *s)
+{
+        buffer_append(buffer, s, strlen(s));
+}
+
+void buffer_append_n(struct Buffer *buffer, char c, size_t n)
+{
+        buffer_reserve(buffer, n);
+        memset(buffer->data + buffer->len, c, n);
+        buffer->len += n;
+        buffer->data[buffer->len] = '\0';
+}
+
+// s as a json string, quotes included
+void buffer_append_json(struct Buffer *buffer, const char *s)
+{
+        buffer_append(buffer, "\"", 1);
+        for (; *s; ++s) {
+                unsigned char c = *s;
+                if (c == '"' || c == '\\') {
+                        char escaped[2] = { '\\', c };
+                        buffer_append(buffer, escaped, 2);
+                } else if (c < 0x20) {
+                        char escaped[8];
+                        snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                        buffer_append(buffer, escaped, 6);
+                } else {
+                        buffer_append(buffer, (const char *)&c, 1);
+                }
+        }
+        buffer_append(buffer, "\"", 1);
+}
+
+bool read_full(int fd, void *buf, size_t len)
+{
+        char *p = buf;
+        while (len > 0) {
+                ssize_t n = read(fd, p, len);
+                if (n == -1 && errno == EINTR)
+                        continue;
+                if (n <= 0)
+                        return false;
+                p += n;
+                len -= n;
+        }
+        return true;
+}
+
+bool write_full(int fd, const char *data, size_t len)
+{
+        while (len > 0) {
+                ssize_t n = write(fd, data, len);
+                if (n < 0 && errno == EINTR)
+                        continue;
+                if (n <= 0)
+                        return false;
+                data += n;
+                len -= n;
+        }
+        return true;
+}
+
+// terminal columns of one code point, east asian wide and fullwidth forms take two
+int codepoint_width(uint32_t cp)
+{
+        if (cp < 0x20 || (cp >= 0x7f && cp < 0xa0))
+                return 0;
+        if ((cp >= 0x0300 && cp <= 0x036f) || (cp >= 0x200b && cp <= 0x200f) || (cp >= 0xfe00 && cp <= 0xfe0f))
+                return 0; // combining marks, zero width space/joiners, variation selectors
+        if ((cp >= 0x1100 && cp <= 0x115f) || (cp >= 0x2e80 && cp <= 0x303e) || (cp >= 0x3041 && cp <= 0x33ff) ||
+            (cp >= 0x3400 && cp <= 0x4dbf) || (cp >= 0x4e00 && cp <= 0x9fff) || (cp >= 0xa000 && cp <= 0xa4cf) ||
+            (cp >= 0xac00 && cp <= 0xd7a3) || (cp >= 0xf900 && cp <= 0xfaff) || (cp >= 0xfe30 && cp <= 0xfe4f) ||
+            (cp >= 0xff00 && cp <= 0xff60) || (cp >= 0xffe0 && cp <= 0xffe6) || (cp >= 0x1f300 && cp <= 0x1f64f) ||
+            (cp >= 0x1f900 && cp <= 0x1f9ff) || (cp >= 0x20000 && cp <= 0x3fffd))
+                return 2;
+        return 1;
+}
+
+// terminal columns of utf-8 s, a malformed byte counts as one column
+size_t display_width(const char *s)
+{
+        const unsigned char *p = (const unsigned char *)s;
+        size_t width = 0;
+        while (*p) {
+                if (*p < 0x80) {
+                        width += codepoint_width(*p++);
+                        continue;
+                }
+                int n = (*p & 0xe0) == 0xc0 ? 2 : (*p & 0xf0) == 0xe0 ? 3 : (*p & 0xf8) == 0xf0 ? 4 : 0;
+                uint32_t cp = *p & (0x7f >> n);
+                int i = 1;
+                for (; i < n && (p[i] & 0xc0) == 0x80; ++i)
+                        cp = cp << 6 | (p[i] & 0x3f);
+                if (n == 0 || i < n) {
+                        width++;
+                        p++;
+                        continue;
+                }
+                width += codepoint_width(cp);
+                p += n;
+        }
+        return width;
+}
+
+// a table taller than the terminal goes through $PAGER(default less), anything else straight to stdout
+void write_paged(const struct Buffer *out, size_t lines, bool no_pager)
+{
+        struct winsize ws;
+        const char *pager = getenv("PAGER");
+        if (pager == NULL)
+                pager = "less -RFX";
+        if (!no_pager && pager[0] != '\0' && isatty(STDOUT_FILENO) && ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && lines >= ws.ws_row) {
+                FILE *pipe = popen(pager, "w");
+                if (pipe) {
+                        // quitting the pager early is not an error
+                        void (*handler)(int) = signal(SIGPIPE, SIG_IGN);
+                        fwrite(out->data, 1, out->len, pipe);
+                        pclose(pipe);
+                        signal(SIGPIPE, handler);
+                        return;
+                }
+        }
+        if (!write_full(STDOUT_FILENO, out->data, out->len))
+                fprintf(stderr, "ERROR: config_print write fail: %s\n", strerror(errno));
+}
+
+const char *config_item_column(const struct ConfigItem *item, enum TableColumn column)
+{
+        if (column == TABLE_COLUMN_NAME)
+                return item->name;
+        if (column == TABLE_COLUMN_KEY)
+                return item->key;
+        return item->value;
+}
+
+// one pass filters the rows and measures them, the whole table is then rendered into one buffer
+// and written with a single write(or through the pager). value is masked in every format
+void config_print(struct Config *config, const struct TableOptions *options)
+{
+        TRACE_BEGIN(span, "config_print");
+        static const char *header[TABLE_COLUMN_COUNT] = { "name", "key", "value" };
+        static const struct TableOptions every = { 0 };
+        if (options == NULL)
+                options = &every;
+        enum TableColumn columns[TABLE_COLUMN_COUNT] = { TABLE_COLUMN_NAME, TABLE_COLUMN_KEY, TABLE_COLUMN_VALUE };
+        int columns_len = TABLE_COLUMN_COUNT;
+        if (options->columns_len > 0) {
+                memcpy(columns, options->columns, options->columns_len * sizeof(*columns));
+                columns_len = options->columns_len;
+        }
+        if (config->len == 0) {
+                printf("ERROR: no config was found, should be installed with config.txt(format: [name] [key] [value]).\n");
+                TRACE_END(span);
+                return;
+        }
+        int *rows = malloc(config->len * sizeof(*rows));
+        size_t *widths = malloc(config->len * TABLE_COLUMN_COUNT * sizeof(*widths));
+        if (rows == NULL || widths == NULL)
+                fatal("ERROR: config_print rows malloc fail");
+        size_t column_len[TABLE_COLUMN_COUNT];
+        for (int j = 0; j < TABLE_COLUMN_COUNT; ++j)
+                column_len[j] = strlen(header[j]);
+        int rows_len = 0;
+        size_t bytes = 0;
+        for (int i = 0; i < config->len; ++i) {
+                struct ConfigItem *item = &config->items[i];
+                if (options->filter && !strcasestr(item->name, options->filter) && !strcasestr(item->key, options->filter))
+                        continue;
+                size_t *width = &widths[rows_len * TABLE_COLUMN_COUNT];
+                for (int j = 0; j < columns_len; ++j) {
+                        const char *element = config_item_column(item, columns[j]);
+                        width[columns[j]] = display_width(element);
+                        bytes += strlen(element);
+                        column_len[columns[j]] = MAX(column_len[columns[j]], width[columns[j]]);
+                }
+                rows[rows_len++] = i;
+        }
+        if (rows_len == 0) {
+                printf("ERROR: no config matches filter '%s'.\n", options->filter);
+                free(widths);
+                free(rows);
+                TRACE_END(span);
+                return;
+        }
+
+        // reserve the whole output at once: cells, then padding, separators, colors and quoting per line
+        struct Buffer out = { 0 };
+        size_t line_len = columns_len * 16 + 8;
+        for (int j = 0; j < columns_len; ++j)
+                line_len += column_len[columns[j]] + 4;
+        buffer_reserve(&out, bytes + (rows_len * 2 + 3) * line_len);
+        size_t lines = 0;
+        if (options->format == TABLE_FORMAT_TSV) {
+                for (int j = 0; j < columns_len; ++j) {
+                        buffer_append_str(&out, header[columns[j]]);
+                        buffer_append(&out, j == columns_len - 1 ? "\n" : "\t", 1);
+                }
+                for (int i = 0; i < rows_len; ++i) {
+                        struct ConfigItem *item = &config->items[rows[i]];
+                        for (int j = 0; j < columns_len; ++j) {
+                                if (columns[j] == TABLE_COLUMN_VALUE)
+                                        buffer_append_n(&out, '*', widths[i * TABLE_COLUMN_COUNT + columns[j]]);
+                                else
+                                        buffer_append_str(&out, config_item_column(item, columns[j]));
+                                buffer_append(&out, j == columns_len - 1 ? "\n" : "\t", 1);
+                        }
+                }
+                lines = rows_len + 1;
+        } else if (options->format == TABLE_FORMAT_JSON) {
+                buffer_append_str(&out, "[\n");
+                for (int i = 0; i < rows_len; ++i) {
+                        struct ConfigItem *item = &config->items[rows[i]];
+                        buffer_append_str(&out, "  {");
+                        for (int j = 0; j < columns_len; ++j) {
+                                buffer_append_json(&out, header[columns[j]]);
+                                buffer_append_str(&out, ": ");
+                                if (columns[j] == TABLE_COLUMN_VALUE) {
+                                        buffer_append(&out, "\"", 1);
+                                        buffer_append_n(&out, '*', widths[i * TABLE_COLUMN_COUNT + columns[j]]);
+                                        buffer_append(&out, "\"", 1);
+                                } else {
+                                        buffer_append_json(&out, config_item_column(item, columns[j]));
+                                }
+                                if (j < columns_len - 1)
+                                        buffer_append_str(&out, ", ");
+                        }
+                        buffer_append_str(&out, i < rows_len - 1 ? "},\n" : "}\n");
+                }
+                buffer_append_str(&out, "]\n");
+                lines = rows_len + 2;
+        } else {
+                // for left && right padding
+                for (int j = 0; j < TABLE_COLUMN_COUNT; ++j)
+                        column_len[j] += 4;
+                const char *vertical_separator = "¦";
+                size_t width = columns_len + 1; // "|"s
+                for (int j = 0; j < columns_len; ++j)
+                        width += column_len[columns[j]];
+                buffer_append_n(&out, '-', width);
+                buffer_append(&out, "\n", 1);
+                for (int j = 0; j < columns_len; ++j) {
+                        size_t header_len = strlen(header[columns[j]]);
+                        size_t left_padding = (column_len[columns[j]] - header_len) / 2;
+                        buffer_append_str(&out, vertical_separator);
+                        buffer_append_n(&out, ' ', left_padding);
+                        buffer_append_str(&out, ANSI_COLOR_YELLOW);
+                        buffer_append_str(&out, header[columns[j]]);
+                        buffer_append_str(&out, ANSI_COLOR_RESET);
+                        buffer_append_n(&out, ' ', column_len[columns[j]] - left_padding - header_len);
+                }
+                buffer_append_str(&out, vertical_separator);
+                buffer_append(&out, "\n", 1);
+                for (int i = 0; i < rows_len; ++i) {
+                        struct ConfigItem *item = &config->items[rows[i]];
+                        buffer_append_n(&out, '-', width);
+                        buffer_append(&out, "\n", 1);
+                        for (int j = 0; j < columns_len; ++j) {
+                                size_t element_len = widths[i * TABLE_COLUMN_COUNT + columns[j]];
+                                size_t left_padding = (column_len[columns[j]] - element_len) / 2;
+                                buffer_append_str(&out, vertical_separator);
+                                buffer_append_n(&out, ' ', left_padding);
+                                if (columns[j] == TABLE_COLUMN_VALUE)
+                                        buffer_append_n(&out, '*', element_len);
+                                else
+                                        buffer_append_str(&out, config_item_column(item, columns[j]));
+                                buffer_append_n(&out, ' ', column_len[columns[j]] - left_padding - element_len);
+                        }
+                        buffer_append_str(&out, vertical_separator);
+                        buffer_append(&out, "\n", 1);
+                }
+                buffer_append_n(&out, '-', width);
+                buffer_append(&out, "\n", 1);
+                lines = rows_len * 2 + 3;
+        }
+        fflush(stdout); // keep the order with output of earlier actions
+        write_paged(&out, lines, options->no_pager);
+        free(out.data);
+        free(widths);
+        free(rows);
+        TRACE_END(span);
+}
+
+void config_destroy(struct Config *config)
+{
+        free(config->items);
+        free(config->strings);
+        free(config->by_name);
+        if (config->fuzzy)
+                fuzzy_index_destroy(config->fuzzy);
+        free(config);
+}
+
+
+// every -ssh/-scp session appends one fixed size record to the session log with a single
+// O_APPEND write, `kit --stats` maps the log and summarizes it. the log is $KIT_SESSION_LOG
+// or ~/.kit_sessions, set KIT_SESSION_LOG to empty string to disable recording
+#define SESSION_LOG_NAME      ".kit_sessions"
+#define SESSION_RECORD_MAGIC  0x3174696b // "kit1" little endian
+#define SESSION_NAME_LEN      64
+#define SESSION_PROBE_TIMEOUT 2000 // ms
+
+enum SessionCommand {
+        SESSION_SSH = 1,
+        SESSION_SCP = 2,
+        SESSION_SSH_REMOTE = 3, // -ssh <name> -- <cmd>...
+};
+
+struct SessionRecord {
+        uint32_t magic;
+        int32_t exit_code;
+        int64_t start;       // epoch second
+        int64_t connect_us;  // tcp connect latency to the host, -1 if unknown
+        int64_t duration_us;
+        uint64_t bytes_sent; // scp only
+        uint8_t command;     // enum SessionCommand
+        uint8_t reserved[7];
+        char name[SESSION_NAME_LEN]; // config name, truncated
+};
+
+_Static_assert(sizeof(struct SessionRecord) == 112, "session record layout is part of the log format");
+
+bool session_log_path(char *path, size_t size)
+{
+        char *env = getenv("KIT_SESSION_LOG");
+        if (env != NULL) {
+                snprintf(path, size, "%s", env);
+                return env[0] != '\0';
+        }
+        char *home = getenv("HOME");
+        if (home == NULL)
+                return false;
+        snprintf(path, size, "%s/%s", home, SESSION_LOG_NAME);
+        return true;
+}
+
+bool session_log_enabled()
+{
+        char path[PATH_MAX];
+        return session_log_path(path, sizeof(path));
+}
+
+// find host and port in "ssh foo@bar -p 7000", false if there is no user@host
+bool session_target(const char *ssh_config_key, char *host, size_t host_size, char *port, size_t port_size)
+{
+        bool found = false;
+        bool is_prev_port_flag = false;
+        snprintf(port, port_size, "22");
+        const char *rest = ssh_config_key;
+        const char *token;
+        size_t len;
+        while (next_token(&rest, &token, &len)) {
+                const char *at = memchr(token, '@', len);
+                if (is_prev_port_flag) {
+                        snprintf(port, port_size, "%.*s", (int)len, token);
+                        is_prev_port_flag = false;
+                } else if (len == 2 && strncmp(token, "-p", 2) == 0) {
+                        is_prev_port_flag = true;
+                } else if (at != NULL) {
+                        snprintf(host, host_size, "%.*s", (int)(token + len - at - 1), at + 1);
+                        found = true;
+                }
+        }
+        return found;
+}
+
+// time a plain tcp connect to host:port, which tracks the link without the auth prompt in it
+int64_t session_probe_connect(const char *host, const char *port)
+{
+        struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+        struct addrinfo *res = NULL;
+        if (getaddrinfo(host, port, &hints, &res) != 0)
+                return -1;
+        int64_t latency = -1;
+        int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        if (fd != -1) {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                struct timespec start;
+                struct timespec end;
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                int rc = connect(fd, res->ai_addr, res->ai_addrlen);
+                if (rc == -1 && errno == EINPROGRESS) {
+                        struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+                        int err = -1;
+                        socklen_t err_len = sizeof(err);
+                        if (poll(&pfd, 1, SESSION_PROBE_TIMEOUT) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &err_len) == 0)
+                                rc = err == 0 ? 0 : -1;
+                }
+                clock_gettime(CLOCK_MONOTONIC, &end);
+                if (rc == 0)
+                        latency = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+                close(fd);
+        }
+        freeaddrinfo(res);
+        return latency;
+}
+
+// connect latency for the record of a session whose ssh/scp was just forked: the probe runs while
+// ssh/scp resolve, connect and authenticate, several round trips to its one, so neither the start
+// of the session nor its duration waits on it. -1 without a user@host in the key
+int64_t session_probe(const char *ssh_config_key)
+{
+        char host[256];
+        char port[16];
+        if (!session_log_enabled() || !session_target(ssh_config_key, host, sizeof(host), port, sizeof(port)))
+                return -1;
+        return session_probe_connect(host, port);
+}
+
+static uint64_t session_bytes;
+
+int session_sum_file(const char *path, const struct stat *sb, int typeflag, struct FTW *ftwbuf)
+{
+        (void)path;
+        (void)ftwbuf;
+        if (typeflag == FTW_F)
+                session_bytes += sb->st_size;
+        return 0;
+}
+
+// total size of local files(directories are walked, scp runs with -r)
+uint64_t session_bytes_of(char **paths, int len)
+{
+        session_bytes = 0;
+        for (int i = 0; i < len; ++i)
+                nftw(paths[i], session_sum_file, 16, FTW_PHYS);
+        return session_bytes;
+}
+
+int session_exit_code(int status)
+{
+        if (WIFEXITED(status))
+                return WEXITSTATUS(status);
+        if (WIFSIGNALED(status))
+                return 128 + WTERMSIG(status);
+        return -1;
+}
+
+int64_t session_elapsed_us(struct timeval *start, struct timeval *end)
+{
+        return (int64_t)(end->tv_sec - start->tv_sec) * 1000000 + (end->tv_usec - start->tv_usec);
+}
+
+// best effort, a session that already happened should not fail because of its log
+void session_log_append(struct SessionRecord *record)
+{
+        char path[PATH_MAX];
+        if (!session_log_path(path, sizeof(path)))
+                return;
+        record->magic = SESSION_RECORD_MAGIC;
+        int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0600);
+        if (fd == -1) {
+                fprintf(stderr, "WARNING: open session log %s fail: %s\n", path, strerror(errno));
+                return;
+        }
+        if (write(fd, record, sizeof(*record)) != sizeof(*record))
+                fprintf(stderr, "WARNING: write session log %s fail: %s\n", path, strerror(errno));
+        close(fd);
+}
+
+struct SessionStatsRow {
+        char key[SESSION_NAME_LEN];
+        const struct SessionRecord *record;
+};
+
+// rows group by key and kind of session, an interactive ssh, an scp and a remote batch
+// take too different times to share one set of percentiles
+int session_stats_row_cmp(const void *a, const void *b)
+{
+        const struct SessionStatsRow *x = a;
+        const struct SessionStatsRow *y = b;
+        int rc = strcmp(x->key, y->key);
+        return rc != 0 ? rc : x->record->command - y->record->command;
+}
+
+const char *session_command_name(uint8_t command)
+{
+        if (command == SESSION_SSH)
+                return "ssh";
+        if (command == SESSION_SCP)
+                return "scp";
+        if (command == SESSION_SSH_REMOTE)
+                return "remote";
+        return "?";
+}
+
+int session_stats_double_cmp(const void *a, const void *b)
+{
+        double x = *(const double *)a;
+        double y = *(const double *)b;
+        return (x > y) - (x < y);
+}
+
+// nearest rank percentile over sorted values
+double session_stats_percentile(double *sorted, int len, double p)
+{
+        int rank = (int)(p * len + 0.999999);
+        return sorted[MAX(rank, 1) - 1];
+}
+
+void session_stats_print_percentiles(double *values, int len, double scale)
+{
+        if (len == 0) {
+                printf("  %26s", "-");
+                return;
+        }
+        qsort(values, len, sizeof(*values), session_stats_double_cmp);
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.1f/%.1f/%.1f", session_stats_percentile(values, len, 0.50) / scale,
+                 session_stats_percentile(values, len, 0.95) / scale, session_stats_percentile(values, len, 0.99) / scale);
+        printf("  %26s", buf);
+}
+
+void session_stats_group(const char *title, struct SessionStatsRow *rows, int len)
+{
+        qsort(rows, len, sizeof(*rows), session_stats_row_cmp);
+        double *connect = malloc(sizeof(*connect) * len);
+        double *duration = malloc(sizeof(*duration) * len);
+        double *throughput = malloc(sizeof(*throughput) * len);
+        if (connect == NULL || duration == NULL || throughput == NULL)
+                fatal("ERROR: session_stats_group values malloc fail");
+        printf(ANSI_COLOR_YELLOW "%-24s %-7s %8s %6s  %26s  %26s  %26s" ANSI_COLOR_RESET "\n", title, "command", "sessions", "fail",
+               "connect p50/p95/p99 ms", "duration p50/p95/p99 s", "scp p50/p95/p99 MB/s");
+        for (int first = 0; first < len;) {
+                const struct SessionRecord *head = rows[first].record;
+                int last = first;
+                int connect_len = 0;
+                int throughput_len = 0;
+                int fail = 0;
+                for (; last < len && strcmp(rows[first].key, rows[last].key) == 0 && rows[last].record->command == head->command; ++last) {
+                        const struct SessionRecord *record = rows[last].record;
+                        if (record->connect_us >= 0)
+                                connect[connect_len++] = record->connect_us;
+                        duration[last - first] = record->duration_us;
+                        // bytes per microsecond is MB/s
+                        if (record->command == SESSION_SCP && record->exit_code == 0 && record->duration_us > 0)
+                                throughput[throughput_len++] = (double)record->bytes_sent / record->duration_us;
+                        if (record->exit_code != 0)
+                                fail++;
+                }
+                printf("%-24s %-7s %8d %6d", rows[first].key, session_command_name(head->command), last - first, fail);
+                session_stats_print_percentiles(connect, connect_len, 1000.0);
+                session_stats_print_percentiles(duration, last - first, 1000000.0);
+                session_stats_print_percentiles(throughput, throughput_len, 1.0);
+                putc('\n', stdout);
+                first = last;
+        }
+        free(connect);
+        free(duration);
+        free(throughput);
+}
+
+void session_stats_print()
+{
+        char path[PATH_MAX];
+        if (!session_log_path(path, sizeof(path)))
+                fatal("ERROR: session log is disabled, set KIT_SESSION_LOG or HOME");
+        int fd = open(path, O_RDONLY);
+        if (fd == -1) {
+                if (errno == ENOENT) {
+                        printf("No session was recorded in %s yet.\n", path);
+                        return;
+                }
+                fatal("ERROR: open session log %s fail: %s", path, strerror(errno));
+        }
+        struct stat st;
+        if (fstat(fd, &st) == -1)
+                fatal("ERROR: stat session log %s fail: %s", path, strerror(errno));
+        size_t len = st.st_size / sizeof(struct SessionRecord); // a torn tail record is ignored
+        if (len == 0) {
+                printf("No session was recorded in %s yet.\n", path);
+                close(fd);
+                return;
+        }
+        struct SessionRecord *records = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (records == MAP_FAILED)
+                fatal("ERROR: mmap session log %s fail: %s", path, strerror(errno));
+        struct SessionStatsRow *rows = malloc(sizeof(*rows) * len);
+        if (rows == NULL)
+                fatal("ERROR: session_stats_print rows malloc fail");
+        int rows_len = 0;
+        for (size_t i = 0; i < len; ++i) {
+                if (records[i].magic != SESSION_RECORD_MAGIC)
+                        continue;
+                rows[rows_len].record = &records[i];
+                snprintf(rows[rows_len].key, sizeof(rows[rows_len].key), "%.*s", SESSION_NAME_LEN - 1, records[i].name);
+                rows_len++;
+        }
+        session_stats_group("host", rows, rows_len);
+        putc('\n', stdout);
+        for (int i = 0; i < rows_len; ++i) {
+                time_t start = rows[i].record->start;
+                struct tm day;
+                strftime(rows[i].key, sizeof(rows[i].key), "%Y-%m-%d", localtime_r(&start, &day));
+        }
+        session_stats_group("day", rows, rows_len);
+        free(rows);
+        munmap(records, st.st_size);
+        close(fd);
+}
+
+// mktime without the tzset it does on every call: the local time is first read as utc, then shifted
+// by the utc offset at that instant, and once more if the shift crossed a dst change
+time_t local_mktime(struct tm *broken_down_time)
+{
+        time_t utc = timegm(broken_down_time);
+        struct tm local;
+        localtime_r(&utc, &local);
+        time_t epoch = utc - local.tm_gmtoff;
+        localtime_r(&epoch, &local);
+        return utc - local.tm_gmtoff;
+}
+
+// epoch(second or millisecond) -> "YYYY-MM-DD hh:mm:ss" and vice versa, result is written to out
+void timestamp_convert(const char *timestamp, char *out, size_t out_size)
+{
+        TRACE_BEGIN(span, "timestamp_convert");
+        bool is_epoch = true;
+        size_t len = strlen(timestamp);
+        for (size_t i = 0; i < len; ++i) {
+                if (timestamp[i] == '-') {
+                        is_epoch = false;
+                        break;
+                }
+        }
+        if (is_epoch && len != EPOCH_SECCOND_LEN && len != EPOCH_MILLISECOND_LEN)
+                fatal("ERROR: invalid timestamp length, can only be 10(second) or 13(millisecond)");
+        if (is_epoch) {
+                time_t epoch = (time_t)str_to_long(timestamp, 10);
+                struct tm broken_down_time;
+                strftime(out, out_size, "%Y-%m-%d %H:%M:%S", localtime_r(&epoch, &broken_down_time));
+        } else {
+                struct tm broken_down_time = { 0 };
+                char *rc = strptime(timestamp, "%Y-%m-%d %H:%M:%S", &broken_down_time);
+                if (rc == NULL || *rc != '\0')
+                        fatal("ERROR: format time only support YYYY-MM-DD hh:mm:ss format(2025-11-12 11:33:22)");
+                time_t epoch_second = local_mktime(&broken_down_time);
+                snprintf(out, out_size, "%ld", epoch_second);
+        }
+        TRACE_END(span);
+}
+
+// glibc looks at TZ again on every localtime/mktime and, while TZ is unset, copies the name of the
+// default zone each time. the zone is loaded once here and later calls go through localtime_r and
+// local_mktime, which do not look again. TZ is left as is, so children get the caller's
+void timezone_init()
+{
+        tzset();
+}
+
+// query recent alarms of one kind(column) for a line before time
+void db_alarm_query(char *query, size_t size, const char *column, bool with_package_type, const char *line, const char *query_time)
+{
+        snprintf(query, size, "SELECT cid, %s, alarm_at%s FROM alarm WHERE equipment_code = '%s线' AND %s = true AND alarm_at < '%s' ORDER BY id DESC LIMIT 100;",
+                 column, with_package_type ? ", package_type" : "", line, column, query_time);
+}
+
+// collect content for the clipboard, content of several actions is joined by new line
+void app_clipboard(struct App *app, const char *content)
+{
+        size_t len = strlen(content);
+        size_t need = app->clipboard_len + len + 2; // new line and NUL
+        if (need > app->clipboard_cap) {
+                size_t cap = MAX(need, MAX(app->clipboard_cap * 2, 256));
+                char *clipboard = arena_alloc(&app->arena, cap);
+                if (app->clipboard_len > 0)
+                        memcpy(clipboard, app->clipboard, app->clipboard_len);
+                app->clipboard = clipboard;
+                app->clipboard_cap = cap;
+        }
+        if (app->clipboard_len > 0)
+                app->clipboard[app->clipboard_len++] = '\n';
+        memcpy(app->clipboard + app->clipboard_len, content, len + 1);
+        app->clipboard_len += len;
+}
+
+// config is parsed on first use and shared by every action of this run
+struct Config *app_config(struct App *app)
+{
+        if (app->config == NULL)
+                app->config = config_init();
+        return app->config;
+}
+
+void option_query_line(struct App *app, char *value)
+{
+        app->db_query_line = value;
+}
+
+void option_query_time(struct App *app, char *value)
+{
+        app->db_query_time = value;
+}
+
+void option_pick(struct App *app, char *value)
+{
+        (void)value;
+        app->pick = true;
+}
+
+void option_filter(struct App *app, char *value)
+{
+        app->table.filter = value;
+}
+
+void option_columns(struct App *app, char *value)
+{
+        static const char *names[TABLE_COLUMN_COUNT] = { "name", "key", "value" };
+        app->table.columns_len = 0;
+        for (char *column = value; ; ) {
+                size_t len = strcspn(column, ",");
+                int found = -1;
+                for (int i = 0; i < TABLE_COLUMN_COUNT; ++i)
+                        if (strlen(names[i]) == len && strncmp(column, names[i], len) == 0)
+                                found = i;
+                if (found == -1)
+                        fatal("ERROR: --columns(%s) should be a comma separated list of name, key, value", value);
+                if (app->table.columns_len == TABLE_COLUMN_COUNT)
+                        fatal("ERROR: --columns(%s) has too many columns", value);
+                app->table.columns[app->table.columns_len++] = found;
+                if (column[len] == '\0')
+                        break;
+                column += len + 1;
+        }
+}
+
+void option_format(struct App *app, char *value)
+{
+        if (strcmp(value, "table") == 0)
+                app->table.format = TABLE_FORMAT_TABLE;
+        else if (strcmp(value, "tsv") == 0)
+                app->table.format = TABLE_FORMAT_TSV;
+        else if (strcmp(value, "json") == 0)
+                app->table.format = TABLE_FORMAT_JSON;
+        else
+                fatal("ERROR: --format(%s) should be table, tsv or json", value);
+}
+
+void option_cache(struct App *app, char *value)
+{
+        app->cache_ttl = str_to_long(value, 10);
+        if (app->cache_ttl <= 0)
+                fatal("ERROR: --cache(%s) should be seconds greater than 0", value);
+}
+
+void run_config_print(struct App *app, struct Action *action)
+{
+        (void)action;
+        config_print(app_config(app), &app->table);
+}
+
+void run_stats(struct App *app, struct Action *action)
+{
+        (void)app;
+        (void)action;
+        session_stats_print();
+}
+
+void run_config_value(struct App *app, struct Action *action)
+{
+        struct Config *config = app_config(app);
+        char *name = action->args[0];
+        int i = config_find(config, name);
+        if (i == -1 && app->pick)
+                i = fuzzy_pick(config, name, false);
+        if (i != -1) {
+                printf("%s\n", config->items[i].value);
+                app_clipboard(app, config->items[i].value);
+                return;
+        }
+        printf("ERROR: name '%s' not found in config.", name);
+        if (config->len > 0) {
+                printf("\nDid you mean: ");
+                config_print_suggestions(config, name, false);
+        } else {
+                printf(" No config was found, should be installed with config.txt\n");
+        }
+}
+
+void run_query_batch(struct App *app, struct Action *action)
+{
+        (void)action;
+        char *query = "SELECT equipment_code, is_end, created_at FROM production_batch order by id desc;";
+        printf("%s\n", query);
+        app_clipboard(app, query);
+}
+
+void run_query_load(struct App *app, struct Action *action)
+{
+        (void)action;
+        char query[256];
+        db_alarm_query(query, sizeof(query), "load", false, app->db_query_line, app->db_query_time);
+        printf("%s\n", query);
+        app_clipboard(app, query);
+}
+
+void run_query_sniff_shake(struct App *app, struct Action *action)
+{
+        (void)action;
+        char query1[256];
+        char query2[256];
+        db_alarm_query(query1, sizeof(query1), "sniff", false, app->db_query_line, app->db_query_time);
+        db_alarm_query(query2, sizeof(query2), "shake", false, app->db_query_line, app->db_query_time);
+        printf("%s\n%s\n", query1, query2);
+        app_clipboard(app, query1);
+}
+
+void run_query_dump(struct App *app, struct Action *action)
+{
+        (void)action;
+        char query[256];
+        db_alarm_query(query, sizeof(query), "dump", true, app->db_query_line, app->db_query_time);
+        printf("%s\n", query);
+        app_clipboard(app, query);
+}
+
+void run_query_wash(struct App *app, struct Action *action)
+{
+        (void)action;
+        char query[256];
+        db_alarm_query(query, sizeof(query), "wash", true, app->db_query_line, app->db_query_time);
+        printf("%s\n", query);
+        app_clipboard(app, query);
+}
+
+void run_timestamp(struct App *app, struct Action *action)
+{
+        char converted[64];
+        timestamp_convert(action->args[0], converted, sizeof(converted));
+        printf("%s\n", converted);
+        app_clipboard(app, converted);
+}
+
+void run_number(struct App *app, struct Action *action)
+{
+        (void)app;
+        char *number = action->args[0];
+        char first_bit = number[0];
+        char second_bit = number[1];
+        long decimal;
+        char binary[NUMBER_STR_SIZE];
+        char hex[NUMBER_STR_SIZE];
+        if (first_bit == '0') {
+                if (second_bit == 'b' || second_bit == 'B') {
+                        // binary
+                        decimal = binary_to_decimal(number);
+                        binary_to_hex(number, hex, sizeof(hex));
+                        printf("decimal -- %ld\n", decimal);
+                        printf("binary  -- %s\n", number);
+                        printf("hex     -- %s\n", hex);
+                } else if (second_bit == 'x' || second_bit == 'X') {
+                        // hex
+                        decimal = hex_to_decimal(number);
+                        hex_to_binary(number, binary, sizeof(binary));
+                        printf("decimal -- %ld\n", decimal);
+                        printf("binary  -- %s\n", binary);
+                        printf("hex     -- %s\n", number);
+                } else {
+                        fatal("unknown format: %s, only support decimal, binary(0b or 0B) and hex(0x or 0X)", number);
+                }
+        } else {
+                // decimal
+                decimal_to_binary(number, binary, sizeof(binary));
+                decimal_to_hex(number, hex, sizeof(hex));
+                printf("decimal -- %s\n", number);
+                printf("binary  -- %s\n", binary);
+                printf("hex     -- %s\n", hex);
+        }
+}
+
+void run_calc(struct App *app, struct Action *action)
+{
+        size_t cmd_len = 16; // reserve length for bc <<< ""
+        for (int i = 0; i < action->args_len; ++i)
+                cmd_len += strlen(action->args[i]);
+        char *cmd = arena_alloc(&app->arena, cmd_len);
+        strcpy(cmd, "bc <<< \"");
+        size_t expression_start = strlen(cmd);
+        for (int i = 0; i < action->args_len; ++i)
+                strcat(cmd, action->args[i]);
+        // support 'x' -> '*'
+        for (char *x = strchr(cmd + expression_start, 'x'); x != NULL; x = strchr(x, 'x'))
+                *x = '*';
+        strcat(cmd, "\"");
+        fflush(stdout); // bc output should come after what previous actions printed
+        TRACE_BEGIN(span, "calc_popen");
+        FILE *pipe = popen(cmd, "r");
+        if (pipe == NULL)
+                fatal("ERROR: run_calc popen fail");
+        char buf[1024];
+        while (fgets(buf, sizeof(buf), pipe) != NULL) {
+                fputs(buf, stdout);
+                buf[strcspn(buf, "\n")] = '\0'; // remove the new line character for clipboard
+                app_clipboard(app, buf);
+        }
+        pclose(pipe);
+        TRACE_END(span);
+}
+
+void run_scp(struct App *app, struct Action *action)
+{
+        struct Config *config = app_config(app);
+        int len = action->args_len;
+        if (len < 2)
+                fatal("ERROR: scp need at least one file and a config name: kit -scp <foo_dir> <bar_dir> <exist_config_name>");
+        int i = config_find(config, action->args[len-1]);
+        if (i == -1 && app->pick)
+                i = fuzzy_pick(config, action->args[len-1], true);
+        if (i == -1) {
+                printf("ERROR: can't find scp config name %s. Did you mean: ", action->args[len-1]);
+                config_print_suggestions(config, action->args[len-1], true);
+                return;
+        }
+        struct timeval start;
+        struct timeval end;
+        struct SessionRecord record = { .command = SESSION_SCP, .connect_us = -1 };
+        snprintf(record.name, sizeof(record.name), "%s", config->items[i].name);
+        struct ScpInfo si;
+        scp_info_init(config->items[i].key, &si);
+        char **args = arena_alloc(&app->arena, sizeof(*args) * (len + 5)); // scp -P port -r files... host NULL
+        int args_len = 0;
+        args[args_len++] = "scp";
+        args[args_len++] = "-P";
+        args[args_len++] = si.port;
+        args[args_len++] = "-r";
+        for (int i = 0; i < len - 1; ++i) {
+                args[args_len++] = action->args[i];
+        }
+        args[args_len++] = si.host;
+        args[args_len++] = NULL;
+        // password is needed during the session, so it goes to clipboard right now instead of the batch at the end
+        write_to_clipboard(config->items[i].value);
+        fflush(stdout);
+        gettimeofday(&start, NULL);
+        TRACE_BEGIN(spawn_span, "scp_spawn");
+        int rc = fork();
+        if (rc == -1)
+                fatal("ERROR: run_scp fork fail");
+        if (rc == 0) {
+                execvp("scp", args);
+                fatal("ERROR: scp fail: %s", strerror(errno));
+        }
+        TRACE_END(spawn_span);
+        record.connect_us = session_probe(config->items[i].key);
+        // walked while scp connects and authenticates, not before it starts
+        if (session_log_enabled())
+                record.bytes_sent = session_bytes_of(action->args, len - 1);
+        TRACE_BEGIN(wait_span, "scp_wait");
+        int status = 0;
+        waitpid(rc, &status, 0);
+        TRACE_END(wait_span);
+        gettimeofday(&end, NULL);
+        record.start = start.tv_sec;
+        record.duration_us = session_elapsed_us(&start, &end);
+        record.exit_code = session_exit_code(status);
+        session_log_append(&record);
+        char formattime[128];
+        printf("%s\n", second_to_formattime(end.tv_sec - start.tv_sec, formattime, sizeof(formattime)));
+}
+
+// argv of ssh for "ssh foo@bar -p 7000", with command it runs that without a terminal
+char **ssh_argv(struct App *app, const char *key, char *command)
+{
+        // a key has at most one token per two characters, +5 for -T -n, command and the NULL terminator
+        char **args = arena_alloc(&app->arena, sizeof(*args) * (strlen(key) / 2 + 6));
+        int index = 0;
+        args[index++] = "ssh";
+        if (command) {
+                args[index++] = "-T";
+                args[index++] = "-n";
+        }
+        const char *token;
+        size_t token_len;
+        next_token(&key, &token, &token_len); // first token is ssh, just ignore it
+        while (next_token(&key, &token, &token_len))
+                args[index++] = arena_strndup(&app->arena, token, token_len);
+        if (command)
+                args[index++] = command;
+        args[index] = NULL;
+        return args;
+}
+
+void run_ssh_remote(struct App *app, struct ConfigItem *item, char **commands, int len);
+
+void run_ssh(struct App *app, struct Action *action)
+{
+        struct timeval start;
+        struct timeval end;
+        struct Config *config = app_config(app);
+        char *name = action->args[0];
+        int i = config_find(config, name);
+        if (i == -1 && app->pick)
+                i = fuzzy_pick(config, name, true);
+        if (i == -1) {
+                printf("ERROR: can't find ssh config name %s. Did you mean: ", name);
+                config_print_suggestions(config, name, true);
+                return;
+        }
+        if (action->args_len > 1) { // -ssh <name> -- <cmd>...
+                run_ssh_remote(app, &config->items[i], action->args + 2, action->args_len - 2);
+                return;
+        }
+        struct SessionRecord record = { .command = SESSION_SSH, .connect_us = -1 };
+        snprintf(record.name, sizeof(record.name), "%s", config->items[i].name);
+        char **args = ssh_argv(app, config->items[i].key, NULL);
+        // password is needed during the session, so it goes to clipboard right now instead of the batch at the end
+        write_to_clipboard(config->items[i].value);
+        fflush(stdout);
+        gettimeofday(&start, NULL);
+        TRACE_BEGIN(spawn_span, "ssh_spawn");
+        int rc = fork();
+        if (rc == -1)
+                fatal("ERROR: run_ssh fork fail");
+        if (rc == 0) {
+                execvp("ssh", args);
+                fatal("ERROR: ssh fail: %s", strerror(errno));
+        }
+        TRACE_END(spawn_span);
+        record.connect_us = session_probe(config->items[i].key);
+        TRACE_BEGIN(wait_span, "ssh_wait");
+        int status = 0;
+        waitpid(rc, &status, 0);
+        TRACE_END(wait_span);
+        gettimeofday(&end, NULL);
+        record.start = start.tv_sec;
+        record.duration_us = session_elapsed_us(&start, &end);
+        record.exit_code = session_exit_code(status);
+        session_log_append(&record);
+        char formattime[128];
+        printf("%s\n", second_to_formattime(end.tv_sec - start.tv_sec, formattime, sizeof(formattime)));
+}
+
+// kit -ssh <name> -- <cmd>... runs every cmd on the host over one non interactive ssh connection:
+// the commands are joined into one remote script where each one is followed by a marker line with
+// its exit code, the output comes back through a pipe and is split at the markers.
+// with --cache <seconds>, a result younger than that comes from $XDG_CACHE_HOME/kit(or ~/.cache/kit)
+// instead, keyed by the ssh config key and the command
+#define REMOTE_CACHE_MAGIC 0x3163746b // "ktc1" little endian
+
+struct RemoteResult {
+        const char *command;
+        char *output;
+        size_t output_len;
+        int exit_code;
+        bool done;   // false if the connection broke before the command finished
+        int64_t age; // seconds since it was cached, -1 if it ran now
+};
+
+// file layout of a cached result: header, ssh config key, command, output
+struct RemoteCacheHeader {
+        uint32_t magic;
+        int32_t exit_code;
+        int64_t created; // epoch second
+        uint32_t key_len;
+        uint32_t command_len;
+        uint64_t output_len;
+};
+
+bool remote_cache_path(const char *key, const char *command, char *dir, size_t dir_size, char *path, size_t path_size)
+{
+        char *xdg = getenv("XDG_CACHE_HOME");
+        char *home = getenv("HOME");
+        int n;
+        if (xdg != NULL && xdg[0] != '\0')
+                n = snprintf(dir, dir_size, "%s/kit", xdg);
+        else if (home != NULL)
+                n = snprintf(dir, dir_size, "%s/.cache/kit", home);
+        else
+                return false;
+        if (n < 0 || (size_t)n >= dir_size)
+                return false;
+        uint64_t hash = fnv1a(FNV_OFFSET, key, strlen(key) + 1); // NUL keeps key and command apart
+        hash = fnv1a(hash, command, strlen(command));
+        n = snprintf(path, path_size, "%s/%016llx", dir, (unsigned long long)hash);
+        return n > 0 && (size_t)n < path_size;
+}
+
+// a result younger than ttl seconds, its output is read into the arena
+bool remote_cache_load(struct Arena *arena, const char *key, struct RemoteResult *result, long ttl)
+{
+        char dir[PATH_MAX];
+        char path[PATH_MAX];
+        if (!remote_cache_path(key, result->command, dir, sizeof(dir), path, sizeof(path)))
+                return false;
+        int fd = open(path, O_RDONLY);
+        if (fd == -1)
+                return false;
+        struct RemoteCacheHeader header;
+        size_t key_len = strlen(key);
+        size_t command_len = strlen(result->command);
+        int64_t age = 0;
+        struct stat st;
+        bool ok = read_full(fd, &header, sizeof(header)) && fstat(fd, &st) == 0 &&
+                  header.magic == REMOTE_CACHE_MAGIC && header.key_len == key_len && header.command_len == command_len &&
+                  header.output_len == (uint64_t)st.st_size - sizeof(header) - key_len - command_len;
+        if (ok) {
+                age = time(NULL) - header.created;
+                ok = age >= 0 && age < ttl;
+        }
+        // the file name is a hash, the key and command in it tell a collision apart
+        char *names = ok ? arena_alloc(arena, key_len + command_len) : NULL;
+        ok = ok && read_full(fd, names, key_len + command_len) &&
+             memcmp(names, key, key_len) == 0 && memcmp(names + key_len, result->command, command_len) == 0;
+        char *output = ok ? arena_alloc(arena, header.output_len + 1) : NULL;
+        ok = ok && read_full(fd, output, header.output_len);
+        close(fd);
+        if (!ok)
+                return false;
+        result->output = output;
+        result->output_len = header.output_len;
+        result->exit_code = header.exit_code;
+        result->done = true;
+        result->age = age;
+        return true;
+}
+
+// written to a temporary file and renamed over, so a reader never sees half of it
+void remote_cache_store(const char *key, const struct RemoteResult *result)
+{
+        char dir[PATH_MAX];
+        char path[PATH_MAX];
+        char tmp[PATH_MAX + 32];
+        if (!remote_cache_path(key, result->command, dir, sizeof(dir), path, sizeof(path)))
+                return;
+        for (char *slash = strchr(dir + 1, '/'); slash != NULL; slash = strchr(slash + 1, '/')) {
+                *slash = '\0';
+                mkdir(dir, 0700);
+                *slash = '/';
+        }
+        mkdir(dir, 0700);
+        snprintf(tmp, sizeof(tmp), "%s.%d.tmp", path, (int)getpid());
+        int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        if (fd == -1) {
+                fprintf(stderr, "WARNING: remote_cache_store open %s fail: %s\n", tmp, strerror(errno));
+                return;
+        }
+        struct RemoteCacheHeader header = {
+                .magic = REMOTE_CACHE_MAGIC,
+                .exit_code = result->exit_code,
+                .created = time(NULL),
+                .key_len = strlen(key),
+                .command_len = strlen(result->command),
+                .output_len = result->output_len,
+        };
+        bool ok = write_full(fd, (const char *)&header, sizeof(header)) &&
+                  write_full(fd, key, header.key_len) &&
+                  write_full(fd, result->command, header.command_len) &&
+                  write_full(fd, result->output, result->output_len);
+        if (close(fd) == -1)
+                ok = false;
+        if (!ok || rename(tmp, path) == -1) {
+                fprintf(stderr, "WARNING: remote_cache_store write %s fail: %s\n", path, strerror(errno));
+                unlink(tmp);
+        }
+}
+
+// one shell script for every command that is not done, each in a subshell so exit or cd stays in it
+void remote_script(struct Buffer *script, const struct RemoteResult *results, int len, const char *marker)
+{
+        for (int i = 0; i < len; ++i) {
+                if (results[i].done)
+                        continue;
+                buffer_append_str(script, "(\n");
+                buffer_append_str(script, results[i].command);
+                buffer_append_str(script, "\n) 2>&1; printf '\\n%s %d\\n' ");
+                buffer_append_str(script, marker);
+                buffer_append_str(script, " $?\n");
+        }
+}
+
+// split the output at "\n<marker> <exit code>\n" lines, in the order of the script
+void remote_split(struct Buffer *out, struct RemoteResult *results, int len, const char *marker)
+{
+        char needle[64];
+        int needle_len = snprintf(needle, sizeof(needle), "\n%s ", marker);
+        char *p = out->data;
+        char *end = out->data + out->len;
+        for (int i = 0; i < len && p != NULL; ++i) {
+                if (results[i].done)
+                        continue;
+                char *found = memmem(p, end - p, needle, needle_len);
+                if (found == NULL)
+                        break;
+                char *code_end;
+                long exit_code = strtol(found + needle_len, &code_end, 10);
+                if (code_end == found + needle_len || *code_end != '\n')
+                        break;
+                results[i].output = p;
+                results[i].output_len = found - p;
+                results[i].exit_code = (int)exit_code;
+                results[i].done = true;
+                p = code_end + 1;
+        }
+}
+
+void run_ssh_remote(struct App *app, struct ConfigItem *item, char **commands, int len)
+{
+        if (len == 0)
+                fatal("ERROR: no command after --, e.g. kit -ssh <exist_config_name> -- 'df -h' uptime");
+        struct RemoteResult *results = arena_alloc(&app->arena, sizeof(*results) * len);
+        int pending = 0;
+        for (int i = 0; i < len; ++i) {
+                results[i] = (struct RemoteResult){ .command = commands[i], .age = -1 };
+                if (app->cache_ttl > 0 && remote_cache_load(&app->arena, item->key, &results[i], app->cache_ttl))
+                        continue;
+                pending++;
+        }
+        struct Buffer out = { 0 };
+        int ssh_exit_code = 0;
+        if (pending > 0) {
+                // random marker, so no command output can end another command early
+                unsigned char nonce[8] = { 0 };
+                int fd = open("/dev/urandom", O_RDONLY);
+                if (fd == -1 || !read_full(fd, nonce, sizeof(nonce)))
+                        fatal("ERROR: run_ssh_remote read /dev/urandom fail");
+                close(fd);
+                char marker[40] = "__kit_";
+                for (size_t i = 0; i < sizeof(nonce); ++i)
+                        snprintf(marker + 6 + i * 2, 3, "%02x", nonce[i]);
+                strcat(marker, "__");
+                struct Buffer script = { 0 };
+                remote_script(&script, results, len, marker);
+                char **args = ssh_argv(app, item->key, script.data);
+                struct SessionRecord record = { .command = SESSION_SSH_REMOTE, .connect_us = -1 };
+                snprintf(record.name, sizeof(record.name), "%s", item->name);
+                // password prompt comes from ssh on the terminal, so it goes to clipboard right now
+                write_to_clipboard(item->value);
+                int pipe_fds[2];
+                if (pipe(pipe_fds) == -1)
+                        fatal("ERROR: run_ssh_remote pipe fail: %s", strerror(errno));
+                fflush(stdout);
+                struct timeval start;
+                struct timeval end;
+                gettimeofday(&start, NULL);
+                TRACE_BEGIN(span, "ssh_remote");
+                int rc = fork();
+                if (rc == -1)
+                        fatal("ERROR: run_ssh_remote fork fail");
+                if (rc == 0) {
+                        dup2(pipe_fds[1], STDOUT_FILENO);
+                        close(pipe_fds[0]);
+                        close(pipe_fds[1]);
+                        execvp("ssh", args);
+                        fatal("ERROR: ssh fail: %s", strerror(errno));
+                }
+                close(pipe_fds[1]);
+                record.connect_us = session_probe(item->key); // ssh output waits in the pipe meanwhile
+                for (;;) {
+                        buffer_reserve(&out, 65536);
+                        ssize_t n = read(pipe_fds[0], out.data + out.len, out.cap - out.len - 1);
+                        if (n == -1 && errno == EINTR)
+                                continue;
+                        if (n <= 0)
+                                break;
+                        out.len += n;
+                        out.data[out.len] = '\0';
+                }
+                close(pipe_fds[0]);
+                int status = 0;
+                waitpid(rc, &status, 0);
+                TRACE_END(span);
+                gettimeofday(&end, NULL);
+                free(script.data);
+                ssh_exit_code = session_exit_code(status);
+                record.start = start.tv_sec;
+                record.duration_us = session_elapsed_us(&start, &end);
+                record.exit_code = ssh_exit_code;
+                session_log_append(&record);
+                if (out.len > 0)
+                        remote_split(&out, results, len, marker);
+                for (int i = 0; i < len; ++i) {
+                        if (app->cache_ttl > 0 && results[i].done && results[i].age == -1)
+                                remote_cache_store(item->key, &results[i]);
+                }
+        }
+        // a single command prints its output as is, so kit fits in a pipeline
+        for (int i = 0; i < len; ++i) {
+                struct RemoteResult *result = &results[i];
+                if (len > 1) {
+                        printf(ANSI_COLOR_YELLOW "==> %s: %s", item->name, result->command);
+                        if (result->age >= 0)
+                                printf(" (cached %llds ago)", (long long)result->age);
+                        printf(ANSI_COLOR_RESET "\n");
+                }
+                if (!result->done) {
+                        fflush(stdout);
+                        fprintf(stderr, "ERROR: '%s' did not finish on %s, ssh exit code %d\n", result->command, item->name, ssh_exit_code);
+                        app->exit_code = EXIT_FAILURE;
+                        continue;
+                }
+                fwrite(result->output, 1, result->output_len, stdout);
+                if (len > 1 && result->output_len > 0 && result->output[result->output_len - 1] != '\n')
+                        putc('\n', stdout);
+                if (result->exit_code != 0) {
+                        fflush(stdout);
+                        fprintf(stderr, "'%s' exit code %d on %s\n", result->command, result->exit_code, item->name);
+                        app->exit_code = EXIT_FAILURE;
+                }
+        }
+        free(out.data);
+}
+
+void run_serve(struct App *app, struct Action *action);
+void run_complete(struct App *app, struct Action *action);
+void run_completion(struct App *app, struct Action *action);
+
+// order here is the order of the help message
+static const struct Flag flags[FLAG_COUNT] = {
+        [FLAG_HELP]              = { "-h",   "--help",              FLAG_NO_VALUE,  NULL, NULL, "show this help message" },
+        [FLAG_CONFIG]            = { "-c",   "--config",            FLAG_NO_VALUE,  NULL, run_config_print, "show <exist_config_name>" },
+        [FLAG_CONFIG_VALUE]      = { "-cv",  "--config_value",      FLAG_ONE_VALUE, NULL, run_config_value, "get config value by <exist_config_name>" },
+        [FLAG_QUERY_BATCH]       = { "-qb",  "--query_batch",       FLAG_NO_VALUE,  NULL, run_query_batch, "show query for batch" },
+        [FLAG_QUERY_LOAD]        = { "-ql",  "--query_load",        FLAG_NO_VALUE,  NULL, run_query_load, "show query for load" },
+        [FLAG_QUERY_SNIFF_SHAKE] = { "-qss", "--query_sniff_shake", FLAG_NO_VALUE,  NULL, run_query_sniff_shake, "show query for sniff and shake" },
+        [FLAG_QUERY_DUMP]        = { "-qd",  "--query_dump",        FLAG_NO_VALUE,  NULL, run_query_dump, "show query for dump" },
+        [FLAG_QUERY_WASH]        = { "-qw",  "--query_wash",        FLAG_NO_VALUE,  NULL, run_query_wash, "show qeury for wash" },
+        [FLAG_QUERY_LINE]        = { "-qln", "--query_line",        FLAG_ONE_VALUE, option_query_line, NULL, "1|2|3|4, default is 3" },
+        [FLAG_QUERY_TIME]        = { "-qt",  "--query_time",        FLAG_ONE_VALUE, option_query_time, NULL, "2025-09-12 12:30:21, default is now" },
+        [FLAG_TIMESTAMP]         = { "-t",   "--timestamp",         FLAG_ONE_VALUE, NULL, run_timestamp, "1757651421 -> 2025-09-12 12:30:21, vice versa" },
+        [FLAG_NUMBER]            = { "-n",   "--number",            FLAG_ONE_VALUE, NULL, run_number, "decimal, binary(0b or 0B prefix), hex(0x or 0X prefix) transfer to one another" },
+        [FLAG_CALC]              = { "-C",   "--calc",              FLAG_VALUES,    NULL, run_calc, "wrapper caulucator above bc, in zsh when use multiply('*') need to be quoted, so support replace 'x' for '*', 2x3 <==> 2*3 " },
+        [FLAG_SSH]               = { "-ssh", "--ssh",               FLAG_VALUE_REST, NULL, run_ssh, "kit -ssh <exist_config_name>, or kit -ssh <exist_config_name> -- 'df -h' uptime to run every quoted command over one connection and print the output" },
+        [FLAG_SCP]               = { "-scp", "--scp",               FLAG_VALUES,    NULL, run_scp, "kit -scp <foo_dir> <bar_dir> <exist_config_name>" },
+        [FLAG_STATS]             = { NULL,   "--stats",             FLAG_NO_VALUE,  NULL, run_stats, "connect latency, duration and scp throughput percentiles of recorded sessions per host and per day, ssh, scp and remote commands apart" },
+        [FLAG_SERVE]             = { NULL,   "--serve",             FLAG_NO_VALUE,  NULL, run_serve, "stay resident with config loaded, later -c/-cv/--complete calls are answered by it" },
+        [FLAG_COMPLETE]          = { NULL,   "--complete",          FLAG_REST,      NULL, run_complete, "print candidates for the last of <words...>, the backend of --completion" },
+        [FLAG_COMPLETION]        = { NULL,   "--completion",        FLAG_ONE_VALUE, NULL, run_completion, "bash|zsh, print completion script, e.g. source <(kit --completion zsh)" },
+        [FLAG_PICK]              = { NULL,   "--pick",              FLAG_NO_VALUE,  option_pick, NULL, "when -cv/-ssh/-scp name is not found, use the best similar name if there is exactly one" },
+        [FLAG_FILTER]            = { NULL,   "--filter",            FLAG_ONE_VALUE, option_filter, NULL, "with -c, only rows whose name or key contains <text>, ignoring case" },
+        [FLAG_COLUMNS]           = { NULL,   "--columns",           FLAG_ONE_VALUE, option_columns, NULL, "with -c, columns to show, e.g. name,key" },
+        [FLAG_FORMAT]            = { NULL,   "--format",            FLAG_ONE_VALUE, option_format, NULL, "with -c, table|tsv|json, default is table, value is always masked" },
+        [FLAG_CACHE]             = { NULL,   "--cache",             FLAG_ONE_VALUE, option_cache, NULL, "<seconds>, before -ssh <exist_config_name> -- <cmd>..., reuse results younger than that from ~/.cache/kit" },
+};
+
+// perfect hash over every flag spelling from its length and three characters(third is NUL for "-c"),
+// the multipliers are picked so no two spellings share a value and the switch below compiles
+// to a jump table. a new flag that collides fails the build with a duplicate case value, then
+// pick other multipliers. make bench checks every spelling of flags[] is found(bench_check_flags)
+#define FLAG_HASH(len, third, before_last, last) (((len) * 25 + (third) * 62 + (before_last) * 10 + (last)) % 64)
+
+const struct Flag *flag_lookup(const char *arg)
+{
+        size_t len = strlen(arg);
+        if (len < 2 || arg[0] != '-')
+                return NULL;
+        const unsigned char *s = (const unsigned char *)arg;
+        const struct Flag *flag = NULL;
+        switch (FLAG_HASH(len, s[2], s[len-2], s[len-1])) {
+        case FLAG_HASH(2, '\0', '-', 'h'):
+        case FLAG_HASH(6, 'h', 'l', 'p'):
+                flag = &flags[FLAG_HELP];
+                break;
+        case FLAG_HASH(2, '\0', '-', 'c'):
+        case FLAG_HASH(8, 'c', 'i', 'g'):
+                flag = &flags[FLAG_CONFIG];
+                break;
+        case FLAG_HASH(3, 'v', 'c', 'v'):
+        case FLAG_HASH(14, 'c', 'u', 'e'):
+                flag = &flags[FLAG_CONFIG_VALUE];
+                break;
+        case FLAG_HASH(3, 'b', 'q', 'b'):
+        case FLAG_HASH(13, 'q', 'c', 'h'):
+                flag = &flags[FLAG_QUERY_BATCH];
+                break;
+        case FLAG_HASH(3, 'l', 'q', 'l'):
+        case FLAG_HASH(12, 'q', 'a', 'd'):
+                flag = &flags[FLAG_QUERY_LOAD];
+                break;
+        case FLAG_HASH(4, 's', 's', 's'):
+        case FLAG_HASH(19, 'q', 'k', 'e'):
+                flag = &flags[FLAG_QUERY_SNIFF_SHAKE];
+                break;
+        case FLAG_HASH(3, 'd', 'q', 'd'):
+        case FLAG_HASH(12, 'q', 'm', 'p'):
+                flag = &flags[FLAG_QUERY_DUMP];
+                break;
+        case FLAG_HASH(3, 'w', 'q', 'w'):
+        case FLAG_HASH(12, 'q', 's', 'h'):
+                flag = &flags[FLAG_QUERY_WASH];
+                break;
+        case FLAG_HASH(4, 'l', 'l', 'n'):
+        case FLAG_HASH(12, 'q', 'n', 'e'):
+                flag = &flags[FLAG_QUERY_LINE];
+                break;
+        case FLAG_HASH(3, 't', 'q', 't'):
+        case FLAG_HASH(12, 'q', 'm', 'e'):
+                flag = &flags[FLAG_QUERY_TIME];
+                break;
+        case FLAG_HASH(2, '\0', '-', 't'):
+        case FLAG_HASH(11, 't', 'm', 'p'):
+                flag = &flags[FLAG_TIMESTAMP];
+                break;
+        case FLAG_HASH(2, '\0', '-', 'n'):
+        case FLAG_HASH(8, 'n', 'e', 'r'):
+                flag = &flags[FLAG_NUMBER];
+                break;
+        case FLAG_HASH(2, '\0', '-', 'C'):
+        case FLAG_HASH(6, 'c', 'l', 'c'):
+                flag = &flags[FLAG_CALC];
+                break;
+        case FLAG_HASH(4, 's', 's', 'h'):
+        case FLAG_HASH(5, 's', 's', 'h'):
+                flag = &flags[FLAG_SSH];
+                break;
+        case FLAG_HASH(4, 'c', 'c', 'p'):
+        case FLAG_HASH(5, 's', 'c', 'p'):
+                flag = &flags[FLAG_SCP];
+                break;
+        case FLAG_HASH(7, 's', 't', 's'):
+                flag = &flags[FLAG_STATS];
+                break;
+        case FLAG_HASH(7, 's', 'v', 'e'):
+                flag = &flags[FLAG_SERVE];
+                break;
+        case FLAG_HASH(10, 'c', 't', 'e'):
+                flag = &flags[FLAG_COMPLETE];
+                break;
+        case FLAG_HASH(12, 'c', 'o', 'n'):
+                flag = &flags[FLAG_COMPLETION];
+                break;
+        case FLAG_HASH(6, 'p', 'c', 'k'):
+                flag = &flags[FLAG_PICK];
+                break;
+        case FLAG_HASH(8, 'f', 'e', 'r'):
+                flag = &flags[FLAG_FILTER];
+                break;
+        case FLAG_HASH(9, 'c', 'n', 's'):
+                flag = &flags[FLAG_COLUMNS];
+                break;
+        case FLAG_HASH(8, 'f', 'a', 't'):
+                flag = &flags[FLAG_FORMAT];
+                break;
+        case FLAG_HASH(7, 'c', 'h', 'e'):
+                flag = &flags[FLAG_CACHE];
+                break;
+        default:
+                return NULL;
+        }
+        // every other string landing on the same slot
+        if ((flag->short_name && strcmp(arg, flag->short_name) == 0) || strcmp(arg, flag->long_name) == 0)
+                return flag;
+        return NULL;
+}
+
+// words are what follows kit on the command line up to the one under the cursor,
+// candidates for that last word are printed one per line
+void run_complete(struct App *app, struct Action *action)
+{
+        char *current = action->args_len > 0 ? action->args[action->args_len - 1] : "";
+        size_t current_len = strlen(current);
+        // the flag current belongs to
+        const struct Flag *flag = NULL;
+        int distance = 0;
+        for (int i = action->args_len - 2; i >= 0; --i) {
+                if (strcmp(action->args[i], "--") == 0)
+                        return; // a remote command, nothing kit knows about
+        }
+        for (int i = action->args_len - 2; i >= 0 && flag == NULL; --i) {
+                flag = flag_lookup(action->args[i]);
+                distance++;
+        }
+        bool is_value = flag != NULL && (flag->arity == FLAG_VALUES || ((flag->arity == FLAG_ONE_VALUE || flag->arity == FLAG_VALUE_REST) && distance == 1));
+        if (current[0] == '-' || !is_value) {
+                for (int i = 0; i < FLAG_COUNT; ++i) {
+                        if (flags[i].short_name && strncmp(flags[i].short_name, current, current_len) == 0)
+                                printf("%s\n", flags[i].short_name);
+                        if (strncmp(flags[i].long_name, current, current_len) == 0)
+                                printf("%s\n", flags[i].long_name);
+                }
+                return;
+        }
+        if (flag == &flags[FLAG_QUERY_LINE]) {
+                for (char line = '1'; line <= '4'; ++line) {
+                        if (current_len == 0 || (current_len == 1 && current[0] == line))
+                                printf("%c\n", line);
+                }
+                return;
+        }
+        if (flag == &flags[FLAG_FORMAT]) {
+                static const char *formats[] = { "table", "tsv", "json" };
+                for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
+                        if (strncmp(formats[i], current, current_len) == 0)
+                                printf("%s\n", formats[i]);
+                }
+                return;
+        }
+        bool ssh_only = flag == &flags[FLAG_SSH] || flag == &flags[FLAG_SCP];
+        if (!ssh_only && flag != &flags[FLAG_CONFIG_VALUE])
+                return;
+        int count;
+        struct ConfigItem **items = config_prefix(app_config(app), current, &count);
+        for (int i = 0; i < count; ++i) {
+                if (!ssh_only || config_item_is_ssh(items[i]))
+                        printf("%s\n", items[i]->name);
+        }
+}
+
+void run_completion(struct App *app, struct Action *action)
+{
+        (void)app;
+        char *shell = action->args[0];
+        if (strcmp(shell, "bash") == 0) {
+                // COMP_WORDS keep the quoting as typed(legit\ s, "legit s), kit gets the words unquoted
+                // like zsh's ${(@Q)...} does. an empty answer falls back to file names, e.g. the sources of -scp.
+                // inside an open quote the candidates go in as they are, readline closes the quote
+                printf("_kit()\n"
+                       "{\n"
+                       "        local IFS=$'\\n'\n"
+                       "        local words=() word i\n"
+                       "        for ((i = 1; i <= COMP_CWORD; ++i)); do\n"
+                       "                word=${COMP_WORDS[i]}\n"
+                       "                case $word in\n"
+                       "                \\'*) word=${word#\\'}; word=${word%%\\'} ;;\n"
+                       "                \\\"*) word=${word#\\\"}; word=${word%%\\\"}; word=${word//\\\\\\\"/\\\"} ;;\n"
+                       "                *) word=${word//\\\\\\\\/$'\\a'}; word=${word//\\\\/}; word=${word//$'\\a'/\\\\} ;;\n"
+                       "                esac\n"
+                       "                words+=(\"$word\")\n"
+                       "        done\n"
+                       "        local candidates=($(kit --complete \"${words[@]}\" 2>/dev/null))\n"
+                       "        if [ ${#candidates[@]} -eq 0 ]; then\n"
+                       "                compopt -o default\n"
+                       "                COMPREPLY=()\n"
+                       "                return\n"
+                       "        fi\n"
+                       "        case ${COMP_WORDS[COMP_CWORD]} in\n"
+                       "        \\'* | \\\"*) COMPREPLY=(\"${candidates[@]}\") ;;\n"
+                       "        *) COMPREPLY=($(printf '%%q\\n' \"${candidates[@]}\")) ;;\n"
+                       "        esac\n"
+                       "}\n"
+                       "complete -F _kit kit\n");
+        } else if (strcmp(shell, "zsh") == 0) {
+                printf("#compdef kit\n"
+                       "_kit()\n"
+                       "{\n"
+                       "        local -a candidates\n"
+                       "        candidates=(\"${(@f)$(kit --complete \"${(@Q)words[2,CURRENT]}\" 2>/dev/null)}\")\n"
+                       "        if [[ -n \"${candidates[1]}\" ]]; then\n"
+                       "                compadd -- \"${candidates[@]}\"\n"
+                       "        else\n"
+                       "                _files\n"
+                       "        fi\n"
+                       "}\n"
+                       "compdef _kit kit\n");
+        } else {
+                fatal("ERROR: not supported shell: %s, only support bash and zsh", shell);
+        }
+}
+
+void print_help()
+{
+        printf("OPTIONS:\n");
+        for (int i = 0; i < FLAG_COUNT; ++i) {
+                char short_name[8] = {0};
+                if (flags[i].short_name)
+                        snprintf(short_name, sizeof(short_name), "%s,", flags[i].short_name);
+                printf("    %-6s%-20s%s\n", short_name, flags[i].long_name, flags[i].help);
+        }
+        printf("every action runs in argument order, e.g. kit -t 1757651421 -n 42 -cv <exist_config_name>\n");
+}
+
+// app is provided by the caller(usually on the stack), so a run needs no heap unless the config is parsed
+void app_init(struct App *app, int argc, char **argv)
+{
+        memset(app, 0, offsetof(struct App, arena));
+        arena_init(&app->arena);
+        // first loop search for help flag
+        for (int i = 1; i < argc; i++) {
+                const struct Flag *flag = flag_lookup(argv[i]);
+                if (flag == &flags[FLAG_HELP]) {
+                        print_help();
+                        exit(EXIT_SUCCESS);
+                }
+                if ((flag && flag->arity == FLAG_REST) || strcmp(argv[i], "--") == 0)
+                        break;
+        }
+        // next loop do the init work
+        TRACE_BEGIN(span, "app_init");
+        app->actions = arena_alloc(&app->arena, sizeof(*app->actions) * argc);
+        int i = 1;
+        while (i < argc) {
+                char *arg = argv[i++];
+                if (arg[0] != '-')
+                        fatal("ERROR: invalid flag: %s", arg);
+                const struct Flag *flag = flag_lookup(arg);
+                if (flag == NULL)
+                        fatal("ERROR: unknown flag: %s", arg);
+                struct Action action = { .flag = flag, .args = argv + i };
+                switch (flag->arity) {
+                case FLAG_NO_VALUE:
+                        break;
+                case FLAG_ONE_VALUE:
+                        if (i == argc)
+                                fatal("ERROR: flag(%s) not provide value", arg);
+                        action.args_len = 1;
+                        i++;
+                        break;
+                case FLAG_VALUES:
+                        if (i == argc || is_flag(argv[i]))
+                                fatal("ERROR: flag(%s) not provide value", arg);
+                        for (; i < argc && !is_flag(argv[i]); ++i)
+                                action.args_len++;
+                        break;
+                case FLAG_REST:
+                        action.args_len = argc - i;
+                        i = argc;
+                        break;
+                case FLAG_VALUE_REST:
+                        if (i == argc)
+                                fatal("ERROR: flag(%s) not provide value", arg);
+                        action.args_len = 1;
+                        i++;
+                        if (i < argc && strcmp(argv[i], "--") == 0) {
+                                action.args_len += argc - i;
+                                i = argc;
+                        }
+                        break;
+                }
+                // options are applied at once so they affect every action, wherever they are
+                if (flag->apply)
+                        flag->apply(app, action.args_len > 0 ? action.args[0] : NULL);
+                else
+                        app->actions[app->actions_len++] = action;
+        }
+        if (!app->db_query_line)
+                app->db_query_line = "3";
+        if (!app->db_query_time) {
+                time_t now = time(NULL);
+                struct tm local;
+                strftime(app->db_query_time_now, sizeof(app->db_query_time_now), "%Y-%m-%d %H:%M:%S", localtime_r(&now, &local));
+                app->db_query_time = app->db_query_time_now;
+        }
+        TRACE_END(span);
+}
+
+void app_run(struct App *app)
+{
+        for (int i = 0; i < app->actions_len; ++i) {
+                ALLOC_STATS_BEGIN(mark);
+                app->actions[i].flag->run(app, &app->actions[i]);
+                ALLOC_STATS_REPORT(app->actions[i].flag->long_name, mark);
+        }
+        if (app->clipboard_len > 0)
+                write_to_clipboard(app->clipboard);
+}
+
+void app_destroy(struct App *app)
+{
+        if (app->config)
+                config_destroy(app->config);
+        arena_destroy(&app->arena);
+}
+
+// kit --serve keeps the parsed config and timezone data resident behind a per-user unix socket,
+// a kit call reading the config hands its argv, environment, working directory and stdout/stderr(SCM_RIGHTS)
+// over and gets the exit code back, so the request sees what an in process run would and output goes
+// straight to the caller. every request runs in its own pre-forked worker, a fatal() only ends that request.
+// socket is $KIT_SOCKET, $XDG_RUNTIME_DIR/kit.sock or /tmp/kit-<uid>.sock, set KIT_NO_SERVER to always run in process
+#define SERVER_MAX_REQUEST 65536
+// a round trip costs ~100us, parsing config.txt in process is cheaper below this(~2000 entries)
+#define SERVER_MIN_CONFIG (128 * 1024)
+
+bool server_address(struct sockaddr_un *addr)
+{
+        memset(addr, 0, sizeof(*addr));
+        addr->sun_family = AF_UNIX;
+        char *env = getenv("KIT_SOCKET");
+        char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+        int n;
+        if (env != NULL)
+                n = snprintf(addr->sun_path, sizeof(addr->sun_path), "%s", env);
+        else if (runtime_dir != NULL)
+                n = snprintf(addr->sun_path, sizeof(addr->sun_path), "%s/kit.sock", runtime_dir);
+        else
+                n = snprintf(addr->sun_path, sizeof(addr->sun_path), "/tmp/kit-%d.sock", (int)getuid());
+        return n > 0 && (size_t)n < sizeof(addr->sun_path);
+}
+
+// the other end of a unix socket runs as this user, so a socket planted by someone else
+// (e.g. /tmp/kit-<uid>.sock created first by another user) is never talked to
+bool peer_is_self(int fd)
+{
+#ifdef __linux__
+        struct ucred cred;
+        socklen_t len = sizeof(cred);
+        return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0 && cred.uid == getuid();
+#else
+        uid_t uid;
+        gid_t gid;
+        return getpeereid(fd, &uid, &gid) == 0 && uid == getuid();
+#endif
+}
+
+// request header, followed by argc arguments(without argv[0]), envc environment entries and the
+// working directory, each NUL terminated. stdout and stderr ride along as SCM_RIGHTS
+struct ServerRequest {
+        uint32_t len; // bytes after the header
+        uint32_t argc;
+        uint32_t envc;
+        uint64_t build; // server_build_id of the client
+};
+
+// reply instead of an exit code when the request comes from another build
+#define SERVER_REFUSED -1
+
+// config.txt is compiled in, so a server still running from before `make install` would answer
+// with old config values and an old flag table. both go into the id, a request from a binary
+// with another id is refused and the client runs in process
+uint64_t server_build_id()
+{
+        uint64_t hash = fnv1a(FNV_OFFSET, config_txt, config_txt_len);
+        for (int i = 0; i < FLAG_COUNT; ++i) {
+                if (flags[i].short_name)
+                        hash = fnv1a(hash, flags[i].short_name, strlen(flags[i].short_name) + 1);
+                hash = fnv1a(hash, flags[i].long_name, strlen(flags[i].long_name) + 1);
+                hash = fnv1a(hash, &flags[i].arity, sizeof(flags[i].arity));
+        }
+        return hash;
+}
+
+// a worker serves exactly one request and answers with the exit code itself, then exits with
+// SERVER_WORKER_REPLIED. any other exit status(fatal, --help, killed) is passed on by the master
+#define SERVER_WORKER_REPLIED 125
+
+// runs in a worker, never returns
+void server_handle(struct App *server, int conn)
+{
+        struct ServerRequest request;
+        int fds[2] = { -1, -1 };
+        union {
+                struct cmsghdr align;
+                char buf[CMSG_SPACE(sizeof(fds))];
+        } control;
+        struct iovec iov = { .iov_base = &request, .iov_len = sizeof(request) };
+        struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buf, .msg_controllen = sizeof(control.buf) };
+        if (recvmsg(conn, &msg, MSG_WAITALL) != sizeof(request))
+                exit(EXIT_FAILURE);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg == NULL || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(fds)))
+                exit(EXIT_FAILURE);
+        memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+        // a worker serves a single request, so the buffers can be static
+        static char buf[SERVER_MAX_REQUEST];
+        static char *strings[SERVER_MAX_REQUEST + 3]; // "kit", every string, NULL after argv and env
+        uint32_t len = request.len;
+        uint32_t count = 0;
+        bool ok = len > 0 && len <= SERVER_MAX_REQUEST && read_full(conn, buf, len) && buf[len - 1] == '\0';
+        for (uint32_t i = 0; ok && i < len; ++i) {
+                if (buf[i] == '\0')
+                        count++;
+        }
+        if (!ok || (uint64_t)request.argc + request.envc + 1 != count)
+                exit(EXIT_FAILURE);
+        if (request.build != server_build_id()) {
+                int32_t refused = SERVER_REFUSED;
+                if (write(conn, &refused, sizeof(refused)) != sizeof(refused))
+                        exit(EXIT_FAILURE);
+                exit(SERVER_WORKER_REPLIED);
+        }
+        // strings: "kit" argv... NULL env... NULL cwd
+        char **argv = strings;
+        char **env = strings + request.argc + 2;
+        int argc = request.argc + 1;
+        argv[0] = "kit";
+        char *p = buf;
+        for (uint32_t i = 0; i < request.argc; ++i, p += strlen(p) + 1)
+                argv[i + 1] = p;
+        argv[argc] = NULL;
+        for (uint32_t i = 0; i < request.envc; ++i, p += strlen(p) + 1)
+                env[i] = p;
+        env[request.envc] = NULL;
+        char *cwd = p;
+        dup2(fds[0], STDOUT_FILENO);
+        dup2(fds[1], STDERR_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        environ = env;
+        if (chdir(cwd) == -1)
+                fatal("ERROR: server_handle chdir %s fail: %s", cwd, strerror(errno));
+        timezone_init();
+        TRACE_INIT();
+        struct App app;
+        app_init(&app, argc, argv);
+        app.config = server->config;
+        app.table.no_pager = true;
+        app_run(&app);
+        // answered before the teardown of the worker, exits elsewhere(fatal, --help) are answered by the master
+        TRACE_FLUSH();
+        fflush(NULL);
+        int32_t exit_code = app.exit_code;
+        if (write(conn, &exit_code, sizeof(exit_code)) != sizeof(exit_code))
+                _exit(EXIT_FAILURE);
+        _exit(SERVER_WORKER_REPLIED);
+}
+
+// workers are forked ahead of requests, so accepting a request costs no fork and a slow
+// request(e.g. kit -c in a pager) only holds its own worker
+#define SERVER_SPARES 2
+#define SERVER_WORKERS 64
+
+struct ServerWorker {
+        pid_t pid;
+        int channel; // master end of the socketpair a connection is handed over on
+        int conn;    // connection being served, -1 while idle
+};
+
+struct Server {
+        struct App *app;
+        int listen_fd;
+        int sigchld[2]; // self pipe, SIGCHLD wakes up poll
+        struct ServerWorker workers[SERVER_WORKERS];
+        int workers_len;
+};
+
+static struct Server server;
+
+void server_sigchld(int sig)
+{
+        (void)sig;
+        int saved = errno;
+        ssize_t n = write(server.sigchld[1], "", 1);
+        (void)n; // pipe full, poll wakes up anyway
+        errno = saved;
+}
+
+void server_worker(int channel)
+{
+        char byte;
+        int conn = -1;
+        union {
+                struct cmsghdr align;
+                char buf[CMSG_SPACE(sizeof(conn))];
+        } control;
+        struct iovec iov = { .iov_base = &byte, .iov_len = 1 };
+        struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buf, .msg_controllen = sizeof(control.buf) };
+        if (recvmsg(channel, &msg, 0) != 1)
+                exit(EXIT_SUCCESS); // master gone
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg == NULL || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN(sizeof(conn)))
+                exit(EXIT_FAILURE);
+        memcpy(&conn, CMSG_DATA(cmsg), sizeof(conn));
+        close(channel);
+        server_handle(server.app, conn);
+}
+
+struct ServerWorker *server_spawn()
+{
+        int pair[2];
+        if (server.workers_len == SERVER_WORKERS)
+                return NULL;
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == -1) {
+                fprintf(stderr, "WARNING: server_spawn socketpair fail: %s\n", strerror(errno));
+                return NULL;
+        }
+        pid_t pid = fork();
+        if (pid == -1) {
+                fprintf(stderr, "WARNING: server_spawn fork fail: %s\n", strerror(errno));
+                close(pair[0]);
+                close(pair[1]);
+                return NULL;
+        }
+        if (pid == 0) {
+                signal(SIGCHLD, SIG_DFL);
+                signal(SIGPIPE, SIG_DFL);
+                close(pair[0]);
+                close(server.listen_fd);
+                close(server.sigchld[0]);
+                close(server.sigchld[1]);
+                for (int i = 0; i < server.workers_len; ++i) {
+                        close(server.workers[i].channel);
+                        if (server.workers[i].conn != -1)
+                                close(server.workers[i].conn);
+                }
+                server_worker(pair[1]);
+        }
+        close(pair[1]);
+        struct ServerWorker *worker = &server.workers[server.workers_len++];
+        *worker = (struct ServerWorker){ .pid = pid, .channel = pair[0], .conn = -1 };
+        return worker;
+}
+
+void server_spares()
+{
+        int idle = 0;
+        for (int i = 0; i < server.workers_len; ++i) {
+                if (server.workers[i].conn == -1)
+                        idle++;
+        }
+        for (; idle < SERVER_SPARES; ++idle) {
+                if (server_spawn() == NULL)
+                        return;
+        }
+}
+
+void server_reply(int conn, int32_t reply)
+{
+        if (write(conn, &reply, sizeof(reply)) != sizeof(reply) && errno != EPIPE)
+                fprintf(stderr, "WARNING: server_reply fail: %s\n", strerror(errno));
+        close(conn);
+}
+
+// connection goes to an idle worker, the master keeps its copy to send the exit code.
+// with every worker busy the client is refused and runs in process
+void server_dispatch(int conn)
+{
+        struct ServerWorker *worker = NULL;
+        for (int i = 0; i < server.workers_len && worker == NULL; ++i) {
+                if (server.workers[i].conn == -1)
+                        worker = &server.workers[i];
+        }
+        if (worker == NULL)
+                worker = server_spawn();
+        if (worker == NULL) {
+                server_reply(conn, SERVER_REFUSED);
+                return;
+        }
+        union {
+                struct cmsghdr align;
+                char buf[CMSG_SPACE(sizeof(conn))];
+        } control;
+        memset(&control, 0, sizeof(control));
+        struct iovec iov = { .iov_base = "", .iov_len = 1 };
+        struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buf, .msg_controllen = sizeof(control.buf) };
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(conn));
+        memcpy(CMSG_DATA(cmsg), &conn, sizeof(conn));
+        if (sendmsg(worker->channel, &msg, 0) != 1) {
+                server_reply(conn, SERVER_REFUSED); // worker died, reaped later
+                return;
+        }
+        worker->conn = conn;
+}
+
+void server_reap()
+{
+        int status;
+        pid_t pid;
+        while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+                for (int i = 0; i < server.workers_len; ++i) {
+                        struct ServerWorker *worker = &server.workers[i];
+                        if (worker->pid != pid)
+                                continue;
+                        if (worker->conn != -1 && WIFEXITED(status) && WEXITSTATUS(status) == SERVER_WORKER_REPLIED)
+                                close(worker->conn);
+                        else if (worker->conn != -1)
+                                server_reply(worker->conn, session_exit_code(status));
+                        close(worker->channel);
+                        *worker = server.workers[--server.workers_len];
+                        break;
+                }
+        }
+}
+
+void run_serve(struct App *app, struct Action *action)
+{
+        (void)action;
+        struct sockaddr_un addr;
+        if (!server_address(&addr))
+                fatal("ERROR: socket path too long");
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1)
+                fatal("ERROR: run_serve socket fail: %s", strerror(errno));
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+                if (!peer_is_self(fd))
+                        fatal("ERROR: %s is served by another user, set KIT_SOCKET to another path", addr.sun_path);
+                fatal("ERROR: kit is already serving on %s", addr.sun_path);
+        }
+        unlink(addr.sun_path); // stale socket of a server that is gone
+        mode_t umask_prev = umask(0077);
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+                fatal("ERROR: bind %s fail: %s", addr.sun_path, strerror(errno));
+        umask(umask_prev);
+        if (listen(fd, 64) == -1)
+                fatal("ERROR: listen %s fail: %s", addr.sun_path, strerror(errno));
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        // everything a request would load on its own(timezone_init already ran), workers get it for free through fork
+        config_by_name(app_config(app));
+        config_fuzzy_index(app->config);
+        server.app = app;
+        server.listen_fd = fd;
+        if (pipe(server.sigchld) == -1)
+                fatal("ERROR: run_serve pipe fail: %s", strerror(errno));
+        for (int i = 0; i < 2; ++i) {
+                fcntl(server.sigchld[i], F_SETFL, O_NONBLOCK);
+                fcntl(server.sigchld[i], F_SETFD, FD_CLOEXEC);
+        }
+        struct sigaction sa = { .sa_handler = server_sigchld, .sa_flags = SA_RESTART | SA_NOCLDSTOP };
+        sigemptyset(&sa.sa_mask);
+        sigaction(SIGCHLD, &sa, NULL);
+        signal(SIGPIPE, SIG_IGN); // client gone before the reply
+        fprintf(stderr, "kit serving on %s\n", addr.sun_path);
+        if (config_txt_len < SERVER_MIN_CONFIG)
+                fprintf(stderr, "WARNING: config.txt is %u bytes, calls run faster in process and are not forwarded\n", (unsigned)config_txt_len);
+        server_spares();
+        for (;;) {
+                struct pollfd pfds[2] = { { .fd = fd, .events = POLLIN }, { .fd = server.sigchld[0], .events = POLLIN } };
+                if (poll(pfds, 2, -1) == -1) {
+                        if (errno == EINTR)
+                                continue;
+                        fatal("ERROR: poll fail: %s", strerror(errno));
+                }
+                if (pfds[1].revents) {
+                        char drain[64];
+                        while (read(server.sigchld[0], drain, sizeof(drain)) > 0)
+                                ;
+                        server_reap();
+                        // not right after a dispatch, on a single cpu the fork would delay that request
+                        server_spares();
+                }
+                if (pfds[0].revents == 0)
+                        continue;
+                int conn = accept(fd, NULL, NULL);
+                if (conn == -1) {
+                        if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN || errno == EWOULDBLOCK)
+                                continue;
+                        fatal("ERROR: accept fail: %s", strerror(errno));
+                }
+                fcntl(conn, F_SETFL, fcntl(conn, F_GETFL) & ~O_NONBLOCK); // inherited from fd on BSD
+                if (peer_is_self(conn))
+                        server_dispatch(conn);
+                else
+                        close(conn);
+        }
+}
+
+// only calls that read a big enough config gain from the server, the rest(-n, -t, ...) would just
+// pay the round trip. ssh/scp need the terminal of the caller and --serve is the server itself
+bool client_should_forward(int argc, char **argv)
+{
+        if (getenv("KIT_NO_SERVER") != NULL || config_txt_len < SERVER_MIN_CONFIG)
+                return false;
+        bool reads_config = false;
+        for (int i = 1; i < argc; ++i) {
+                const struct Flag *flag = flag_lookup(argv[i]);
+                if (flag == &flags[FLAG_SSH] || flag == &flags[FLAG_SCP] || flag == &flags[FLAG_SERVE])
+                        return false;
+                if (flag == &flags[FLAG_CONFIG] || flag == &flags[FLAG_CONFIG_VALUE] || flag == &flags[FLAG_COMPLETE])
+                        reads_config = true;
+                if ((flag && flag->arity == FLAG_REST) || strcmp(argv[i], "--") == 0)
+                        break;
+        }
+        return reads_config;
+}
+
+// false when there is no server to talk to, then the caller runs in process
+bool client_forward(int argc, char **argv, int *exit_code)
+{
+        struct sockaddr_un addr;
+        if (!server_address(&addr))
+                return false;
+        char buf[SERVER_MAX_REQUEST];
+        struct ServerRequest request = { .argc = argc - 1, .build = server_build_id() };
+        uint32_t len = 0;
+        for (int i = 1; i < argc; ++i) {
+                size_t n = strlen(argv[i]) + 1;
+                if (len + n > sizeof(buf))
+                        return false;
+                memcpy(buf + len, argv[i], n);
+                len += n;
+        }
+        for (char **env = environ; *env != NULL; ++env, ++request.envc) {
+                size_t n = strlen(*env) + 1;
+                if (len + n > sizeof(buf))
+                        return false;
+                memcpy(buf + len, *env, n);
+                len += n;
+        }
+        if (getcwd(buf + len, sizeof(buf) - len) == NULL)
+                return false;
+        len += strlen(buf + len) + 1;
+        request.len = len;
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1)
+                return false;
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || !peer_is_self(fd)) {
+                close(fd);
+                return false;
+        }
+        int fds[2] = { STDOUT_FILENO, STDERR_FILENO };
+        union {
+                struct cmsghdr align;
+                char buf[CMSG_SPACE(sizeof(fds))];
+        } control;
+        memset(&control, 0, sizeof(control));
+        struct iovec iov[2] = {
+                { .iov_base = &request, .iov_len = sizeof(request) },
+                { .iov_base = buf, .iov_len = len },
+        };
+        struct msghdr msg = { .msg_iov = iov, .msg_iovlen = 2, .msg_control = control.buf, .msg_controllen = sizeof(control.buf) };
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+        if (sendmsg(fd, &msg, 0) != (ssize_t)(sizeof(request) + len)) {
+                close(fd);
+                return false;
+        }
+        // server is up and owns the request now, a missing reply means the request died there
+        int32_t reply;
+        bool replied = read_full(fd, &reply, sizeof(reply));
+        close(fd);
+        if (replied && reply == SERVER_REFUSED)
+                return false;
+        *exit_code = replied ? reply : EXIT_FAILURE;
+        return true;
+}
+
+// bench/ includes this file with KIT_LIB defined to reuse everything except main
+#ifndef KIT_LIB
+int main(int argc, char **argv)
+{
+        int exit_code;
+        if (client_should_forward(argc, argv) && client_forward(argc, argv, &exit_code))
+                return exit_code;
+        TRACE_INIT();
+        ALLOC_STATS_BEGIN(mark);
+        timezone_init();
+        struct App app;
+        app_init(&app, argc, argv);
+        ALLOC_STATS_REPORT("startup", mark);
+        app_run(&app);
+        exit_code = app.exit_code;
+        app_destroy(&app);
+        return exit_code;
+}
+#endif